@@ -0,0 +1,64 @@
+/*
+  ==============================================================================
+
+    Downsampler.cpp
+    Created: 17 Oct 2026 8:20:10am
+    Author:  user
+
+  ==============================================================================
+*/
+
+#include "Downsampler.h"
+
+//worked out with the elliptic half-band design from Laurent de Soras' HIIR library, for a transition band of
+//0.0227 of the rendering sample rate
+const float Downsampler::coefficients[numCoefficients] = {
+    0.035979631f, 0.13420095f, 0.27074408f, 0.41880485f, 0.55799462f,
+    0.67759445f, 0.77509872f, 0.85315153f, 0.91695894f, 0.97284795f
+};
+
+Downsampler::Downsampler() {
+    reset();
+}
+
+void Downsampler::reset() {
+    for (int channel = 0; channel < numChannels; ++channel) {
+        for (int i = 0; i < numCoefficients; ++i) {
+            lastInput[channel][i] = 0.0f;
+            lastOutput[channel][i] = 0.0f;
+        }
+
+        lastOddSample[channel] = 0.0f;
+    }
+}
+
+void Downsampler::process(const float* input, float* output, int numOutputSamples, int channel) {
+    float* x = lastInput[channel];
+    float* y = lastOutput[channel];
+    float oddSample = lastOddSample[channel];
+
+    for (int i = 0; i < numOutputSamples; ++i) {
+        //each chain runs at the lower sample rate, so each of its allpass filters is
+        //y[n] = c * (x[n] - y[n - 1]) + x[n - 1]
+        float even = input[2 * i];
+        float odd = oddSample;
+
+        for (int stage = 0; stage < numCoefficients; stage += 2) {
+            float evenOut = coefficients[stage] * (even - y[stage]) + x[stage];
+            float oddOut = coefficients[stage + 1] * (odd - y[stage + 1]) + x[stage + 1];
+
+            x[stage] = even;
+            y[stage] = evenOut;
+            x[stage + 1] = odd;
+            y[stage + 1] = oddOut;
+
+            even = evenOut;
+            odd = oddOut;
+        }
+
+        output[i] = 0.5f * (even + odd);
+        oddSample = input[2 * i + 1];
+    }
+
+    lastOddSample[channel] = oddSample;
+}
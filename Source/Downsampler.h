@@ -0,0 +1,44 @@
+/*
+  ==============================================================================
+
+    Downsampler.h
+    Created: 17 Oct 2026 8:19:52am
+    Author:  user
+
+  ==============================================================================
+*/
+
+#pragma once
+#include <JuceHeader.h>
+
+//turns audio rendered at twice the sample rate back into audio at the sample rate, filtering out everything above
+//half the sample rate first so that it doesn't alias. The filter is a half-band filter made of two chains of
+//first order allpass filters, one fed the even samples and the other the odd ones, and the output is the average
+//of the two. That cuts about as sharply as a long FIR filter for a handful of multiplies per sample, and has
+//almost no latency
+class Downsampler {
+public:
+    static constexpr int numCoefficients = 10;
+    static constexpr int numChannels = 2;
+
+    Downsampler();
+
+    //clears the history of both channels, so the next block starts from silence
+    void reset();
+
+    //reads 2 * numOutputSamples samples from input and writes numOutputSamples samples into output. Each channel
+    //has its own history, which carries on from the last block
+    void process(const float* input, float* output, int numOutputSamples, int channel);
+
+private:
+    //the coefficients alternate between the even chain and the odd chain. They give a passband flat to within
+    //1e-9 dB up to 20kHz and at least 105dB of attenuation above 24.1kHz when rendering at 88.2kHz, and the same
+    //fractions of any other sample rate
+    static const float coefficients[numCoefficients];
+
+    //the last input and output of each allpass filter, and the last odd sample, which the odd chain is a sample
+    //behind on
+    float lastInput[numChannels][numCoefficients];
+    float lastOutput[numChannels][numCoefficients];
+    float lastOddSample[numChannels];
+};
@@ -0,0 +1,333 @@
+/*
+  ==============================================================================
+
+    Envelope.cpp
+    Created: 17 Oct 2026 8:40:37am
+    Author:  user
+
+  ==============================================================================
+*/
+
+#include "Envelope.h"
+#include <cmath>
+
+double Envelope::getLevel(int sampleIndex, bool isNoteOn, double releaseLevel) const {
+    Stage stage = getStage(sampleIndex, isNoteOn);
+
+    switch (stage) {
+    case ATTACK:
+        return getCurvedLevel(0.0, getStageEndLevel(ATTACK), sampleIndex, attack, attackCurve);
+    case DECAY:
+        return getCurvedLevel(1.0, sustain, sampleIndex - attack, decay, decayCurve);
+    case RELEASE:
+        return getCurvedLevel(releaseLevel, 0.0, sampleIndex, release, releaseCurve);
+    default:
+        return getStageEndLevel(stage);
+    }
+}
+
+Envelope::Stage Envelope::getStage(int sampleIndex, bool isNoteOn) const {
+    if (!isNoteOn) {
+        return sampleIndex < release ? RELEASE : FINISHED;
+    }
+
+    if (sampleIndex < attack) {
+        return ATTACK;
+    }
+
+    if (sampleIndex < attack + decay) {
+        return DECAY;
+    }
+
+    return SUSTAIN;
+}
+
+int Envelope::getStageEnd(int sampleIndex, bool isNoteOn) const {
+    switch (getStage(sampleIndex, isNoteOn)) {
+    case ATTACK:
+        return attack;
+    case DECAY:
+        return attack + decay;
+    case RELEASE:
+        return release;
+    default:
+        return -1;
+    }
+}
+
+int Envelope::getStageLength(Stage stage) const {
+    switch (stage) {
+    case ATTACK:
+        return attack;
+    case DECAY:
+        return decay;
+    case RELEASE:
+        return release;
+    default:
+        return 0;
+    }
+}
+
+double Envelope::getStageCurve(Stage stage) const {
+    switch (stage) {
+    case ATTACK:
+        return attackCurve;
+    case DECAY:
+        return decayCurve;
+    case RELEASE:
+        return releaseCurve;
+    default:
+        return 0.0;
+    }
+}
+
+double Envelope::getStageStartLevel(Stage stage, double releaseLevel) const {
+    switch (stage) {
+    case ATTACK:
+        return 0.0;
+    case DECAY:
+        return 1.0;
+    case RELEASE:
+        return releaseLevel;
+    default:
+        return getStageEndLevel(stage);
+    }
+}
+
+double Envelope::getStageEndLevel(Stage stage) const {
+    switch (stage) {
+    case ATTACK:
+        //without a decay the attack heads straight for the sustain level
+        return decay == 0 ? sustain : 1.0;
+    case DECAY:
+    case SUSTAIN:
+        return sustain;
+    default:
+        return 0.0;
+    }
+}
+
+void Envelope::getCurveSteps(int length, double curve, double& multiplier, double& stepScale) {
+    if (length <= 0 || curve == 0.0) {
+        multiplier = 1.0;
+        stepScale = length > 0 ? 1.0 / static_cast<double>(length) : 0.0;
+        return;
+    }
+
+    //the level heads towards a point past the end of the stage, and gets multiplier closer to it every sample. The
+    //point is far enough past that it gets to the end of the stage on its last sample
+    double bend = curve * maxBend;
+
+    multiplier = std::exp(-bend / static_cast<double>(length));
+    stepScale = (1.0 - multiplier) / (1.0 - std::exp(-bend));
+}
+
+double Envelope::getCurvedLevel(double startLevel, double endLevel, int position, int length, double curve) {
+    double progress = static_cast<double>(position) / static_cast<double>(length);
+
+    //the same exponential that getCurveSteps() steps along, scaled so that it still starts and ends in the same
+    //place
+    if (curve != 0.0) {
+        double bend = curve * maxBend;
+
+        progress = (1.0 - std::exp(-bend * progress)) / (1.0 - std::exp(-bend));
+    }
+
+    return startLevel + (endLevel - startLevel) * progress;
+}
+
+EnvelopeSteps::EnvelopeSteps() {
+    //a length that no stage can have, so that every table gets worked out the first time
+    for (auto& steps : stages) {
+        steps.length = -1;
+        steps.curve = 0.0;
+    }
+}
+
+void EnvelopeSteps::prepare(const Envelope& settings) {
+    for (int i = 0; i < Envelope::numStages; ++i) {
+        auto stage = static_cast<Envelope::Stage>(i);
+        auto& steps = stages[i];
+        int length = settings.getStageLength(stage);
+        double curve = settings.getStageCurve(stage);
+
+        if (steps.length == length && steps.curve == curve) {
+            continue;
+        }
+
+        double multiplier;
+        double stepScale;
+        Envelope::getCurveSteps(length, curve, multiplier, stepScale);
+
+        steps.length = length;
+        steps.curve = curve;
+        steps.multiplier = static_cast<float>(multiplier);
+        steps.stepScale = static_cast<float>(stepScale);
+        steps.startScale = static_cast<float>(1.0 - multiplier - stepScale);
+
+        //the powers are built up in doubles and only rounded once each, so that the long ones don't drift
+        double growth = 1.0;
+        double sum = 0.0;
+
+        for (int k = 0; k <= maxRampLength; ++k) {
+            steps.growth[k] = static_cast<float>(growth);
+            steps.sum[k] = static_cast<float>(sum);
+            sum += growth;
+            growth *= multiplier;
+        }
+    }
+}
+
+double EnvelopeSteps::getStep(Envelope::Stage stage, double from, double to, int numSamples) const {
+    auto& steps = stages[stage];
+
+    return (to - steps.growth[numSamples] * from) / steps.sum[numSamples];
+}
+
+using SIMDFloat = EnvelopeLanes::SIMDFloat;
+using SIMDMask = EnvelopeLanes::SIMDMask;
+
+//where the stages that hold still end, which is further than any sample index gets
+static constexpr float neverEnds = 1.0e30f;
+
+//ifSet in the lanes set in mask, and ifClear in the others
+static inline SIMDFloat select(SIMDMask mask, SIMDFloat ifSet, SIMDFloat ifClear) {
+    return (ifSet & mask) + (ifClear & ~mask);
+}
+
+template <typename GetValue>
+SIMDFloat EnvelopeLanes::StageLanes::get(GetValue getValue) const {
+    auto result = SIMDFloat::expand(0.0f);
+
+    for (int i = 0; i < Envelope::numStages; ++i) {
+        result += SIMDFloat::expand(static_cast<float>(getValue(static_cast<Envelope::Stage>(i)))) & isStage[i];
+    }
+
+    return result;
+}
+
+void EnvelopeLanes::reset() {
+    for (size_t lane = 0; lane < SIMDFloat::SIMDNumElements; ++lane) {
+        resetLane(lane);
+    }
+}
+
+void EnvelopeLanes::resetLane(size_t lane) {
+    level.set(lane, 0.0f);
+    releaseLevel.set(lane, 0.0f);
+    stage.set(lane, static_cast<float>(Envelope::FINISHED));
+    stageEnd.set(lane, neverEnds);
+    breakStage.set(lane, static_cast<float>(Envelope::FINISHED));
+    samplesUntilBreak.set(lane, 0.0f);
+    breakLevel.set(lane, 0.0f);
+    targetLevel.set(lane, 0.0f);
+    samplesUntilRampEnd.set(lane, 0.0f);
+}
+
+void EnvelopeLanes::setUpRamps(const Envelope& settings, const EnvelopeSteps& steps, SIMDFloat sampleIndex,
+    SIMDMask isNoteOn, SIMDMask isMoving, int rampLength) {
+    auto ramp = SIMDFloat::expand(static_cast<float>(rampLength));
+    auto stages = getStages(settings, sampleIndex, isNoteOn);
+
+    //a lane whose stage ends before the control point only goes as far as the end of it to begin with. It lands
+    //right on the end, so the tables only need reading at the whole ramp here, which is the same for every lane
+    auto isBreak = SIMDFloat::lessThan(stages.end - sampleIndex, ramp);
+    auto untilBreak = SIMDFloat::min(stages.end - sampleIndex, ramp);
+    auto growth = stages.get([&](Envelope::Stage s) { return steps.stages[s].growth[rampLength]; });
+    auto sum = stages.get([&](Envelope::Stage s) { return steps.stages[s].sum[rampLength]; });
+
+    auto newBreakLevel = moveOn(settings, steps, stages, sampleIndex, level, untilBreak, growth, sum);
+    auto newBreakStage = stages.stage;
+    auto newTargetLevel = newBreakLevel;
+    auto newRampEnd = ramp;
+
+    //stages only end every so often, so most of the time no lane gets this far
+    if ((isBreak & isMoving) != 0u) {
+        auto breakIndex = sampleIndex + untilBreak;
+        auto breakStages = getStages(settings, breakIndex, isNoteOn);
+
+        //the ramp stops at the end of the stage after the break if that comes first. The level there is the one
+        //that stage ends on, and the stage after it always holds still
+        auto samplesAfterBreak = SIMDFloat::min(ramp - untilBreak, breakStages.end - breakIndex);
+
+        //the rest of the ramp is a different length in each lane, so the tables are read one lane at a time
+        auto breakGrowth = SIMDFloat::expand(1.0f);
+        auto breakSum = SIMDFloat::expand(0.0f);
+
+        for (size_t lane = 0; lane < SIMDFloat::SIMDNumElements; ++lane) {
+            auto& table = steps.stages[static_cast<int>(breakStages.stage.get(lane))];
+            int numSamples = static_cast<int>(samplesAfterBreak.get(lane));
+
+            breakGrowth.set(lane, table.growth[numSamples]);
+            breakSum.set(lane, table.sum[numSamples]);
+        }
+
+        auto afterBreakLevel = moveOn(settings, steps, breakStages, breakIndex, newBreakLevel, samplesAfterBreak,
+            breakGrowth, breakSum);
+
+        newBreakStage = select(isBreak, breakStages.stage, stages.stage);
+        newTargetLevel = select(isBreak, afterBreakLevel, newBreakLevel);
+        newRampEnd = select(isBreak, untilBreak + samplesAfterBreak, ramp);
+    }
+
+    //the lanes that aren't moving keep the ramp they are already on
+    stage = select(isMoving, stages.stage, stage);
+    stageEnd = select(isMoving, stages.end, stageEnd);
+    breakStage = select(isMoving, newBreakStage, breakStage);
+    samplesUntilBreak = select(isMoving, untilBreak, samplesUntilBreak);
+    breakLevel = select(isMoving, newBreakLevel, breakLevel);
+    targetLevel = select(isMoving, newTargetLevel, targetLevel);
+    samplesUntilRampEnd = select(isMoving, newRampEnd, samplesUntilRampEnd);
+}
+
+Envelope::Stage EnvelopeLanes::getStage(size_t lane) const {
+    return static_cast<Envelope::Stage>(static_cast<int>(stage.get(lane)));
+}
+
+Envelope::Stage EnvelopeLanes::getBreakStage(size_t lane) const {
+    return static_cast<Envelope::Stage>(static_cast<int>(breakStage.get(lane)));
+}
+
+EnvelopeLanes::StageLanes EnvelopeLanes::getStages(const Envelope& settings, SIMDFloat sampleIndex,
+    SIMDMask isNoteOn) {
+    auto attackEnd = SIMDFloat::expand(static_cast<float>(settings.attack));
+    auto decayEnd = SIMDFloat::expand(static_cast<float>(settings.attack + settings.decay));
+    auto releaseEnd = SIMDFloat::expand(static_cast<float>(settings.release));
+
+    StageLanes stages;
+    auto& isStage = stages.isStage;
+
+    isStage[Envelope::ATTACK] = isNoteOn & SIMDFloat::lessThan(sampleIndex, attackEnd);
+    isStage[Envelope::DECAY] = isNoteOn & SIMDFloat::lessThan(sampleIndex, decayEnd) & ~isStage[Envelope::ATTACK];
+    isStage[Envelope::RELEASE] = SIMDFloat::lessThan(sampleIndex, releaseEnd) & ~isNoteOn;
+    stages.isHeld = ~(isStage[Envelope::ATTACK] | isStage[Envelope::DECAY] | isStage[Envelope::RELEASE]);
+    isStage[Envelope::SUSTAIN] = stages.isHeld & isNoteOn;
+    isStage[Envelope::FINISHED] = stages.isHeld & ~isNoteOn;
+
+    stages.stage = stages.get([](Envelope::Stage s) { return s; });
+    stages.end = (attackEnd & isStage[Envelope::ATTACK]) + (decayEnd & isStage[Envelope::DECAY]) +
+        (releaseEnd & isStage[Envelope::RELEASE]) + (SIMDFloat::expand(neverEnds) & stages.isHeld);
+
+    return stages;
+}
+
+SIMDFloat EnvelopeLanes::moveOn(const Envelope& settings, const EnvelopeSteps& steps, const StageLanes& stages,
+    SIMDFloat sampleIndex, SIMDFloat from, SIMDFloat numSamples, SIMDFloat growth, SIMDFloat sum) const {
+    auto endLevels = stages.get([&](Envelope::Stage s) { return settings.getStageEndLevel(s); });
+    auto stepScales = stages.get([&](Envelope::Stage s) { return steps.stages[s].stepScale; });
+    auto startScales = stages.get([&](Envelope::Stage s) { return steps.stages[s].startScale; });
+
+    //the release is the only stage that starts from a different level in each lane
+    auto startLevels = stages.get([&](Envelope::Stage s) {
+        return s == Envelope::RELEASE ? 0.0 : settings.getStageStartLevel(s, 0.0);
+    });
+    startLevels += releaseLevel & stages.isStage[Envelope::RELEASE];
+
+    auto step = stepScales * endLevels + startScales * startLevels;
+
+    //the end of a stage is landed on exactly, so that rounding doesn't build up from one stage to the next. A
+    //stage that holds still heads straight for the level it holds, in case the sustain has been moved
+    auto isAtEnd = stages.isHeld | SIMDFloat::greaterThanOrEqual(sampleIndex + numSamples, stages.end);
+
+    return select(isAtEnd, endLevels, growth * from + sum * step);
+}
@@ -9,6 +9,7 @@
 */
 
 #pragma once
+#include <JuceHeader.h>
 
 class Envelope {
 public:
@@ -18,7 +19,142 @@ public:
     int release;
     double amount;
 
+    //how curved each stage is, between -1 and 1. At 0 the stage is a straight line, above 0 it moves quickly at
+    //first and then slows down like an analogue envelope, and below 0 it starts slowly and speeds up
+    double attackCurve = 0.0;
+    double decayCurve = 0.0;
+    double releaseCurve = 0.0;
+
     //the integer attributes will be measured in samples
     //sustain is between 0 and 1
+
+    //SUSTAIN and FINISHED (after the release) hold the level still, the others move it
+    enum Stage {
+        ATTACK,
+        DECAY,
+        SUSTAIN,
+        RELEASE,
+        FINISHED
+    };
+
+    static constexpr int numStages = 5;
+
+    //how far along the envelope is (between 0 and 1, before amount) sampleIndex samples into the note, or into
+    //its release if the note is off. The release starts from releaseLevel
+    double getLevel(int sampleIndex, bool isNoteOn, double releaseLevel) const;
+
+    Stage getStage(int sampleIndex, bool isNoteOn) const;
+
+    //the first sample after sampleIndex where the envelope changes stage, or -1 if it stays in the same stage
+    int getStageEnd(int sampleIndex, bool isNoteOn) const;
+
+    int getStageLength(Stage stage) const;
+    double getStageCurve(Stage stage) const;
+
+    //the levels a stage goes between. A stage that holds still starts and ends on the level it holds
+    double getStageStartLevel(Stage stage, double releaseLevel) const;
+    double getStageEndLevel(Stage stage) const;
+
+    //a curved stage is an exponential, so the level can be moved on a sample with one multiply and one add:
+    //level = level * multiplier + step. This works out the multiplier for a stage of the given length and curve (1
+    //for a straight line), and the step for a stage from level 0 to level 1. For a stage from start to end the step
+    //is stepScale * (end - start) + (1 - multiplier) * start
+    static void getCurveSteps(int length, double curve, double& multiplier, double& stepScale);
+
+private:
+    //how much the exponential of a curve of 1 bends over a stage
+    static constexpr double maxBend = 8.0;
+
+    static double getCurvedLevel(double startLevel, double endLevel, int position, int length, double curve);
 };
 
+//the tables for moving an envelope on by a whole ramp at once, which every voice shares. For each stage, growth[k]
+//is multiplier^k and sum[k] is 1 + multiplier + ... + multiplier^(k - 1), so k samples of the stage take the level to
+//growth[k] * level + sum[k] * step (see Envelope::getCurveSteps()). The step of a stage from start to end is
+//stepScale * end + startScale * start, where startScale is worked out in doubles since it is 1 - multiplier -
+//stepScale, which is a small difference of numbers close to 1 in a long stage. The tables are only worked out again
+//when the length or curve of a stage changes
+struct EnvelopeSteps {
+    static constexpr int maxRampLength = 256;
+
+    struct StageSteps {
+        int length;
+        double curve;
+        float multiplier;
+        float stepScale;
+        float startScale;
+        float growth[maxRampLength + 1];
+        float sum[maxRampLength + 1];
+    };
+
+    StageSteps stages[Envelope::numStages];
+
+    EnvelopeSteps();
+
+    void prepare(const Envelope& settings);
+
+    //the step that takes a stage from one level to another in numSamples samples
+    double getStep(Envelope::Stage stage, double from, double to, int numSamples) const;
+};
+
+//the envelope of a group of voices, with one voice in each SIMD lane, in the same way as FilterLanes. The stage each
+//lane is in and where it ends are found by comparing its sample index with the ends of the stages, so the whole group
+//is moved on to its next control point with the same instructions whatever stage each of its voices is in
+struct EnvelopeLanes {
+    using SIMDFloat = juce::dsp::SIMDRegister<float>;
+    using SIMDMask = SIMDFloat::vMaskType;
+
+    SIMDFloat level;            //where each lane was at its last control point
+    SIMDFloat releaseLevel;     //where each lane was when its note was released
+
+    //the way to the next control point. A lane follows stage for samplesUntilBreak samples, where it gets to
+    //breakLevel, and breakStage from there to targetLevel. Without a change of stage before the control point
+    //samplesUntilBreak is the whole ramp, and the break is the target. The stages are Envelope::Stages kept as
+    //floats, and stageEnd is the sample index where stage ends (a long way off for the stages that hold still)
+    SIMDFloat stage;
+    SIMDFloat stageEnd;
+    SIMDFloat breakStage;
+    SIMDFloat samplesUntilBreak;
+    SIMDFloat breakLevel;
+    SIMDFloat targetLevel;
+
+    //how long the ramp lasts. When breakStage ends before the control point as well (a decay shorter than the
+    //control interval, say), the ramp stops right on the end of it, and a new one has to be set up from there.
+    //Otherwise it is the whole way to the control point
+    SIMDFloat samplesUntilRampEnd;
+
+    void reset();
+    void resetLane(size_t lane);
+
+    //points the lanes set in isMoving at where their envelopes will be rampLength samples on. sampleIndex is how far
+    //each lane is into its note, or into its release where isNoteOn isn't set
+    void setUpRamps(const Envelope& settings, const EnvelopeSteps& steps, SIMDFloat sampleIndex, SIMDMask isNoteOn,
+        SIMDMask isMoving, int rampLength);
+
+    Envelope::Stage getStage(size_t lane) const;
+    Envelope::Stage getBreakStage(size_t lane) const;
+
+private:
+    //the stage that each lane is in at some sample index, both as an Envelope::Stage and as a mask for each stage,
+    //and the sample index where it ends
+    struct StageLanes {
+        SIMDFloat stage;
+        SIMDFloat end;
+        SIMDMask isStage[Envelope::numStages];
+        SIMDMask isHeld;        //set for SUSTAIN and FINISHED, which hold still
+
+        //something that depends on the stage, for the stage that each lane is in. It is picked out with the masks
+        //rather than with a switch for each lane
+        template <typename GetValue>
+        SIMDFloat get(GetValue getValue) const;
+    };
+
+    //the same as Envelope::getStage() and Envelope::getStageEnd(), for every lane at once
+    static StageLanes getStages(const Envelope& settings, SIMDFloat sampleIndex, SIMDMask isNoteOn);
+
+    //moves the level of each lane on from sampleIndex by numSamples samples of its stage, using the given entries of
+    //the stage's tables. Lanes that get to the end of their stage, or are in one that holds still, land on exactly
+    //the level it ends on
+    SIMDFloat moveOn(const Envelope& settings, const EnvelopeSteps& steps, const StageLanes& stages,
+        SIMDFloat sampleIndex, SIMDFloat from, SIMDFloat numSamples, SIMDFloat growth, SIMDFloat sum) const;
+};
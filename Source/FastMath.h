@@ -0,0 +1,209 @@
+/*
+  ==============================================================================
+
+    FastMath.h
+    Created: 17 Oct 2026 7:03:48pm
+    Author:  user
+
+  ==============================================================================
+*/
+
+#pragma once
+#include <JuceHeader.h>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+//set this to 0 to use the exact functions from <cmath> instead, to check whether a difference in the sound comes
+//from the approximations
+#ifndef NEA_FAST_MATH
+ #define NEA_FAST_MATH 1
+#endif
+
+//polynomial approximations of the functions that the pitch, LFO and filter calculations need. None of them branch,
+//so a loop over an array of them can be vectorised by the compiler. sin2Pi() and cos2Pi() also take a
+//SIMDRegister<float>, which works out every lane at once. The others are scalar only, because a SIMDRegister has
+//no way to divide or to get at the exponent bits of a float.
+//
+//The errors are the largest found by comparing against <cmath> in double at a million points across each range.
+//In float they are limited by rounding to about 2e-7 instead
+class FastMath {
+public:
+    //sin(2 * pi * cycles) for any cycles. The angle is given in cycles because that is what the phases are kept
+    //in. Error below 3.4e-9
+    template <typename T>
+    static inline T sin2Pi(T cycles) {
+       #if NEA_FAST_MATH
+        using Scalar = typename ScalarOf<T>::type;
+
+        //brought into [-0.5, 0.5] and then folded into [-0.25, 0.25], where sin(2 * pi * x) is an odd polynomial.
+        //sin(2 * pi * (0.5 - x)) is the same as sin(2 * pi * x), and so is sin(2 * pi * (-0.5 - x))
+        T x = cycles - roundToWhole(cycles);
+        x = minOf(x, x * Scalar(-1) + Scalar(0.5));
+        x = maxOf(x, x * Scalar(-1) - Scalar(0.5));
+
+        T xSquared = x * x;
+        T result = xSquared * Scalar(39.53665207870691) + Scalar(-76.54977489642037);
+        result = result * xSquared + Scalar(81.60100374200643);
+        result = result * xSquared + Scalar(-41.34165502619186);
+        result = result * xSquared + Scalar(6.2831851600712785);
+
+        return result * x;
+       #else
+        return exactly(cycles, [](auto x) { return std::sin(juce::MathConstants<decltype(x)>::twoPi * x); });
+       #endif
+    }
+
+    //cos(2 * pi * cycles), which is sin2Pi() a quarter of a cycle on. Error below 3.4e-9
+    template <typename T>
+    static inline T cos2Pi(T cycles) {
+        return sin2Pi(cycles + typename ScalarOf<T>::type(0.25));
+    }
+
+    //tan(pi * x) for x between -0.5 and 0.5, which is what a bilinear filter prewarps its cutoff with (x being the
+    //cutoff over the sample rate). The relative error is below 2.7e-8 up to 20kHz at a 44.1kHz sample rate, and
+    //grows as x gets closer to 0.5
+    static inline double tanPi(double x) {
+       #if NEA_FAST_MATH
+        return sin2Pi(0.5 * x) / cos2Pi(0.5 * x);
+       #else
+        return std::tan(juce::MathConstants<double>::pi * x);
+       #endif
+    }
+
+    //2 to the power of x, for x between -1000 and 1000. Relative error below 1.9e-9
+    static inline double exp2(double x) {
+       #if NEA_FAST_MATH
+        //x is split into a whole number n and a fraction f between -0.5 and 0.5. 2^n is put together straight from
+        //its exponent bits, and 2^f is a polynomial
+        double n = roundToWhole(x);
+        double f = x - n;
+
+        double result = f * 0.00015345775205513094 + 0.0013399931338323925;
+        result = result * f + 0.009618489102560761;
+        result = result * f + 0.05550328776608528;
+        result = result * f + 0.24022646889148117;
+        result = result * f + 0.6931472057374648;
+        result = result * f + 1.00000000055441;
+
+        auto exponentBits = static_cast<juce::uint64>(static_cast<juce::int64>(n) + 1023) << 52;
+        double twoToTheN;
+        std::memcpy(&twoToTheN, &exponentBits, sizeof(double));
+
+        return result * twoToTheN;
+       #else
+        return std::exp2(x);
+       #endif
+    }
+
+    //the log base 2 of x, for any positive x that isn't a denormal. Error below 6.7e-9
+    static inline double log2(double x) {
+       #if NEA_FAST_MATH
+        //x is split into its exponent e and a mantissa m between 1 and 2. m is then halved if it is above sqrt(2)
+        //(and e one higher) so that it is close to 1, where log2(m) is a polynomial in m - 1
+        juce::uint64 bits;
+        std::memcpy(&bits, &x, sizeof(double));
+
+        auto e = static_cast<double>(static_cast<int>((bits >> 52) & 0x7ff) - 1023);
+        bits = (bits & 0x000fffffffffffffull) | 0x3ff0000000000000ull;
+
+        double m;
+        std::memcpy(&m, &bits, sizeof(double));
+
+        double isHigh = m > juce::MathConstants<double>::sqrt2 ? 1.0 : 0.0;
+        m *= 1.0 - 0.5 * isHigh;
+        e += isHigh;
+
+        double t = m - 1.0;
+        double result = t * 0.1254045359255428 + -0.2103005105610446;
+        result = result * t + 0.21738122938722954;
+        result = result * t + -0.23851997245485995;
+        result = result * t + 0.2876565083902516;
+        result = result * t + -0.36072116490545447;
+        result = result * t + 0.4809225354981706;
+        result = result * t + -0.7213471289363691;
+        result = result * t + 1.442694868474198;
+
+        return e + result * t;
+       #else
+        return std::log2(x);
+       #endif
+    }
+
+    //base to the power of x, for a positive base, as exp2(x * log2(base))
+    static inline double pow(double base, double x) {
+        return exp2(x * log2(base));
+    }
+
+private:
+    template <typename T>
+    struct ScalarOf {
+        using type = T;
+    };
+
+    template <typename T>
+    struct ScalarOf<juce::dsp::SIMDRegister<T>> {
+        using type = T;
+    };
+
+    //the whole number nearest to x (halves can go either way). Converting to an integer truncates towards zero in
+    //a single instruction, where std::floor() is often a function call, and the comparisons then move anything more
+    //than half away one further
+    template <typename T>
+    static inline T roundToWhole(T x) {
+        auto whole = static_cast<T>(static_cast<juce::int64>(x));
+        T fraction = x - whole;
+
+        return whole + static_cast<T>(fraction > T(0.5)) - static_cast<T>(fraction < T(-0.5));
+    }
+
+    template <typename T>
+    static inline juce::dsp::SIMDRegister<T> roundToWhole(juce::dsp::SIMDRegister<T> x) {
+        using Register = juce::dsp::SIMDRegister<T>;
+
+        //truncating rounds towards zero, so anything more than half away from that needs moving one further
+        auto whole = Register::truncate(x);
+        auto fraction = x - whole;
+        auto one = Register::expand(T(1));
+
+        whole += one & Register::greaterThan(fraction, Register::expand(T(0.5)));
+        whole -= one & Register::lessThan(fraction, Register::expand(T(-0.5)));
+
+        return whole;
+    }
+
+    template <typename T>
+    static inline T minOf(T a, T b) {
+        return std::min(a, b);
+    }
+
+    template <typename T>
+    static inline juce::dsp::SIMDRegister<T> minOf(juce::dsp::SIMDRegister<T> a, juce::dsp::SIMDRegister<T> b) {
+        return juce::dsp::SIMDRegister<T>::min(a, b);
+    }
+
+    template <typename T>
+    static inline T maxOf(T a, T b) {
+        return std::max(a, b);
+    }
+
+    template <typename T>
+    static inline juce::dsp::SIMDRegister<T> maxOf(juce::dsp::SIMDRegister<T> a, juce::dsp::SIMDRegister<T> b) {
+        return juce::dsp::SIMDRegister<T>::max(a, b);
+    }
+
+    //applies an exact scalar function to x, or to every lane of it
+    template <typename T, typename Function>
+    static inline T exactly(T x, Function function) {
+        return function(x);
+    }
+
+    template <typename T, typename Function>
+    static inline juce::dsp::SIMDRegister<T> exactly(juce::dsp::SIMDRegister<T> x, Function function) {
+        for (size_t lane = 0; lane < juce::dsp::SIMDRegister<T>::SIMDNumElements; ++lane) {
+            x.set(lane, function(x.get(lane)));
+        }
+
+        return x;
+    }
+};
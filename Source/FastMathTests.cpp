@@ -0,0 +1,73 @@
+/*
+  ==============================================================================
+
+    FastMathTests.cpp
+    Created: 17 Oct 2026 9:12:40pm
+    Author:  user
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include "FastMath.h"
+
+//checks each function in FastMath against <cmath> at a million points across its range, with the error bound that
+//FastMath.h gives for it. Like JUCE's own tests these are only built with JUCE_UNIT_TESTS set, and are run with
+//juce::UnitTestRunner().runTestsInCategory("NEASynthesiser")
+#if JUCE_UNIT_TESTS
+
+class FastMathTests : public juce::UnitTest {
+public:
+    FastMathTests() : juce::UnitTest("FastMath", "NEASynthesiser") {}
+
+    void runTest() override {
+        beginTest("sin2Pi");
+        expectLessOrEqual(getLargestError(-4.0, 4.0, [](double x) {
+            return std::abs(FastMath::sin2Pi(x) - std::sin(juce::MathConstants<double>::twoPi * x));
+        }), 3.4e-9);
+
+        beginTest("cos2Pi");
+        expectLessOrEqual(getLargestError(-4.0, 4.0, [](double x) {
+            return std::abs(FastMath::cos2Pi(x) - std::cos(juce::MathConstants<double>::twoPi * x));
+        }), 3.4e-9);
+
+        //the bound is on the relative error, up to 20kHz at a 44.1kHz sample rate
+        beginTest("tanPi");
+        expectLessOrEqual(getLargestError(-20000.0 / 44100.0, 20000.0 / 44100.0, [](double x) {
+            double exact = std::tan(juce::MathConstants<double>::pi * x);
+            return exact == 0.0 ? std::abs(FastMath::tanPi(x)) : std::abs(FastMath::tanPi(x) / exact - 1.0);
+        }), 2.7e-8);
+
+        beginTest("exp2");
+        expectLessOrEqual(getLargestError(-1000.0, 1000.0, [](double x) {
+            return std::abs(FastMath::exp2(x) / std::exp2(x) - 1.0);
+        }), 1.9e-9);
+
+        //x is spread evenly in octaves, so that every exponent and every mantissa gets tried
+        beginTest("log2");
+        expectLessOrEqual(getLargestError(-1000.0, 1000.0, [](double octaves) {
+            double x = std::exp2(octaves);
+            return std::abs(FastMath::log2(x) - std::log2(x));
+        }), 6.7e-9);
+    }
+
+private:
+    static constexpr int numPoints = 1000000;
+
+    //the largest error out of numPoints points spread evenly from start to end
+    template <typename GetError>
+    static double getLargestError(double start, double end, GetError getError) {
+        double largestError = 0.0;
+
+        for (int i = 0; i < numPoints; ++i) {
+            double x = start + (end - start) * i / (numPoints - 1);
+            largestError = std::max(largestError, getError(x));
+        }
+
+        return largestError;
+    }
+};
+
+static FastMathTests fastMathTests;
+
+#endif
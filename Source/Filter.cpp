@@ -10,131 +10,125 @@
 
 #include "Filter.h"
 #include "PluginProcessor.h"
+#include "FastMath.h"
 #include "cmath"
 
 FrequencyFilter::FrequencyFilter(NEASynthesiserAudioProcessor& p)
     : parentProcessor(p)
 {
     type = LOWPASS;
+    structure = BIQUAD;
     centreFrequency = 20000;
     resonance = 0.7071068;    //sqrt(2) / 2, this is thought of as a default value
-    currentLFOAngle = 0.0f;
+    currentLFOPhase = 0;
 }
 
-std::vector<std::vector<float>> FrequencyFilter::filterAudio(std::vector<std::vector<float>> inputAudio
-    , int currentSampleIndex, bool isNoteOn, std::vector<std::vector<float>> lastTwoInputSamples,
-    std::vector<std::vector<float>> lastTwoOutputSamples, double& releaseFrequency)
+void FilterLanes::reset()
 {
-    // This algorithm is simply a code implementation of the algorithm found here:
-    // https://webaudio.github.io/Audio-EQ-Cookbook/audio-eq-cookbook.html
+    for (size_t lane = 0; lane < SIMDFloat::SIMDNumElements; ++lane) {
+        resetLane(lane);
+    }
 
-    double frequency = getCurrentCentreFrequency(currentSampleIndex, isNoteOn, releaseFrequency);
-    auto blockSize = inputAudio[0].size();
+    c1 = c2 = c3 = c4 = SIMDFloat::expand(0.0f);
+    c1Step = c2Step = c3Step = c4Step = SIMDFloat::expand(0.0f);
+}
 
-    if (parentProcessor.lfo.destination == parentProcessor.lfo.FILTER) {
-        double lfoFactor = std::pow(parentProcessor.lfo.amount, std::sin(currentLFOAngle));
-        frequency = std::min(frequency * lfoFactor, 20000.0);
+void FilterLanes::resetLane(size_t lane)
+{
+    for (int channel = 0; channel < 2; ++channel) {
+        x1[channel].set(lane, 0.0f);
+        x2[channel].set(lane, 0.0f);
+        y1[channel].set(lane, 0.0f);
+        y2[channel].set(lane, 0.0f);
+        ic1[channel].set(lane, 0.0f);
+        ic2[channel].set(lane, 0.0f);
     }
+}
 
-    double omega = juce::MathConstants<double>::twoPi * frequency / parentProcessor.sampleRate;
-    double alpha = std::sin(omega) / (2 * resonance);
-    double cosOmega = std::cos(omega);
+bool FrequencyFilter::isStateVariable() const
+{
+    return structure == STATE_VARIABLE || type == BANDPASS || type == NOTCH;
+}
 
+void FrequencyFilter::getCoefficients(double frequency, juce::uint32 lfoPhase, float& c1, float& c2, float& c3,
+    float& c4) const
+{
+    auto& table = parentProcessor.getFilterTable();
 
-    double a0 = 1 + alpha;
-    
-    double c1, c2, c3, c4;
+    //the table is laid out in octaves, so the frequency is worked out in octaves as well. The LFO multiplies the
+    //frequency by lfo.amount to the power of the sine, which is the same as adding log2(lfo.amount) times the sine
+    double log2Frequency = FastMath::log2(frequency);
 
-    if (type == LOWPASS) {
-        c2 = (1 - cosOmega) / a0;
-        c1 = c2 / 2;
-        c3 = (-2 * cosOmega) / a0;
-        c4 = (1 - alpha) / a0;
-    } 
-    else if (type == HIGHPASS) {
-        c2 = -(1 + cosOmega) / a0;
-        c1 = (1 + cosOmega) / (2 * a0 );
-        c3 = (-2 * cosOmega) / a0;
-        c4 = (1 - alpha) / a0;
+    if (parentProcessor.lfo.destination == parentProcessor.lfo.FILTER) {
+        log2Frequency += FastMath::log2(parentProcessor.lfo.amount) *
+            FastMath::sin2Pi(Oscillator::phaseToCycles(lfoPhase));
     }
 
-    std::vector<float> leftOutput(blockSize, 0.0f);
-    std::vector<float> rightOutput(blockSize, 0.0f);
-
-    //similarly to before, lastTwoInputSamples[0] represents the left channel, and lastTwoInputSamples[1] is the right channel
-    //the same goes for lastTwoOutputSamples
+    double log2Resonance = FastMath::log2(resonance);
 
-    leftOutput[0] = (c1 * inputAudio[0][0]) + (c2 * lastTwoInputSamples[0][1]) + (c1 * lastTwoInputSamples[0][0])
-        - (c3 * lastTwoOutputSamples[0][1]) - (c4 * lastTwoOutputSamples[0][0]);
+    //the table holds anything above its top frequency at the top, which is under the Nyquist frequency, so a cutoff
+    //or LFO that goes higher than the sample rate allows still gets a stable filter
+    jassert(table.isBuilt());
 
-    rightOutput[0] = (c1 * inputAudio[1][0]) + (c2 * lastTwoInputSamples[1][1]) + (c1 * lastTwoInputSamples[1][0])
-        - (c3 * lastTwoOutputSamples[1][1]) - (c4 * lastTwoOutputSamples[1][0]);
+    if (isStateVariable()) {
+        FilterTable::StateVariablePoint point = table.lookUpStateVariable(log2Frequency, log2Resonance);
 
-    //leftOutput[0] = c1 * inputAudio[0][0];
-    //rightOutput[0] = c1 * inputAudio[1][0];
+        c1 = point.a1;
+        c2 = point.a2;
+        c3 = point.a3;
+        c4 = 0.0f;
 
-    //handle case where only one input sample is passed
-    if (blockSize < 2) {
-        return { leftOutput, rightOutput };
+        return;
     }
 
-    //leftOutput[1] = (c1 * inputAudio[0][1]) + (c2 * inputAudio[0][0]) - (c3 * leftOutput[0]);
-    //rightOutput[1] = (c1 * inputAudio[1][1]) + (c2 * inputAudio[1][0]) - (c3 * rightOutput[0]);
-
-    leftOutput[1] = (c1 * inputAudio[0][1]) + (c2 * inputAudio[0][0]) + (c1 * lastTwoInputSamples[0][1])
-        - (c3 * leftOutput[0]) - (c4 * lastTwoOutputSamples[0][1]);
+    FilterTable::Point point = table.lookUp(log2Frequency, log2Resonance);
 
-    rightOutput[1] = (c1 * inputAudio[1][1]) + (c2 * inputAudio[1][0]) + (c1 * lastTwoInputSamples[1][1])
-        - (c3 * rightOutput[0]) - (c4 * lastTwoOutputSamples[1][1]);
-
-    for (int i = 2; i < blockSize; ++i) {
-        leftOutput[i] = (c1 * inputAudio[0][i]) + (c2 * inputAudio[0][i - 1]) + (c1 * inputAudio[0][i - 2])
-            - (c3 * leftOutput[i - 1]) - (c4 * leftOutput[i - 2]);
-
-        rightOutput[i] = (c1 * inputAudio[1][i]) + (c2 * inputAudio[1][i - 1]) + (c1 * inputAudio[1][i - 2])
-            - (c3 * rightOutput[i - 1]) - (c4 * rightOutput[i - 2]);
+    if (type == LOWPASS) {
+        c2 = point.lowPassGain;
+        c1 = c2 / 2;
+    } 
+    else {      //HIGHPASS
+        c2 = -point.highPassGain;
+        c1 = point.highPassGain / 2;
     }
 
-    return { leftOutput, rightOutput };
+    c3 = point.c3;
+    c4 = point.c4;
 }
 
-double FrequencyFilter::getCurrentCentreFrequency(int currentSampleIndex, bool isNoteOn, double& releaseFrequency)
+void FrequencyFilter::getStateVariableMix(float& inputGain, float& bandGain, float& lowGain) const
 {
-    if (isNoteOn == false) {
-        if (currentSampleIndex > env.release) {
-            return centreFrequency;
-        }
-
-        double n = releaseFrequency - centreFrequency;
-        auto ret =  ((-n / env.release) * currentSampleIndex) + centreFrequency + n;
-        
-        return std::fmax(std::fmin(20000, ret), 40);
+    //the band-pass output is turned up by k so that it peaks at 1, which makes the notch the input without it.
+    //The high-pass output is what is left of the input after the other two are taken away
+    auto k = static_cast<float>(1 / resonance);
+
+    switch (type) {
+    case LOWPASS:
+        inputGain = 0.0f;
+        bandGain = 0.0f;
+        lowGain = 1.0f;
+        break;
+    case HIGHPASS:
+        inputGain = 1.0f;
+        bandGain = -k;
+        lowGain = -1.0f;
+        break;
+    case BANDPASS:
+        inputGain = 0.0f;
+        bandGain = k;
+        lowGain = 0.0f;
+        break;
+    case NOTCH:
+        inputGain = 1.0f;
+        bandGain = -k;
+        lowGain = 0.0f;
+        break;
     }
+}
 
-    if (currentSampleIndex < env.attack) {
-        if (env.decay == 0) {
-            auto ret = ((env.amount * env.sustain / env.attack) * currentSampleIndex) + centreFrequency;
-            releaseFrequency = std::fmax(std::fmin(20000, ret), 40);
-            return releaseFrequency;
-        }
-
-        auto ret = ((env.amount / env.attack) * currentSampleIndex) + centreFrequency;
-        releaseFrequency = std::fmax(std::fmin(20000, ret), 40);
-        return releaseFrequency;
-
-    }
-    else if (currentSampleIndex - env.attack < env.decay) {
-        int shiftedCurrentSample = currentSampleIndex - env.attack;
-        double gradient = (env.amount * (env.sustain - 1)) / env.decay;
-        auto ret = (gradient * shiftedCurrentSample) + centreFrequency + env.amount;
-        releaseFrequency = std::fmax(std::fmin(20000, ret), 40);
-        return releaseFrequency;
-
-    } 
-    else {
-        auto ret = centreFrequency + (env.sustain * env.amount);
-        releaseFrequency = std::fmax(std::fmin(20000, ret), 40);
-        return releaseFrequency;
-    }
+double FrequencyFilter::getCentreFrequency(double envelopeLevel) const
+{
+    auto ret = centreFrequency + env.amount * envelopeLevel;
+    return std::fmax(std::fmin(20000, ret), 40);
 }
 
@@ -9,32 +9,68 @@
 */
 
 #pragma once
-#include <vector>
 #include <JuceHeader.h>
 #include "Envelope.h"
 
 class NEASynthesiserAudioProcessor;
 
+//the coefficients and history of the filter for a group of voices, with one voice in each SIMD lane. Each
+//group of voices owns one of these, so that the whole group can be filtered with the same instructions
+struct FilterLanes
+{
+    using SIMDFloat = juce::dsp::SIMDRegister<float>;
+
+    //the state variable filter only uses c1 to c3, as its a1 to a3 (see FilterTable::StateVariablePoint)
+    SIMDFloat c1, c2, c3, c4;
+    SIMDFloat c1Step, c2Step, c3Step, c4Step;     //how much each coefficient changes by every sample
+
+    //index 0 is the left channel and index 1 is the right channel. x1 and y1 are the most recent input and
+    //output samples of the biquad, and x2 and y2 are the ones before those
+    SIMDFloat x1[2], x2[2], y1[2], y2[2];
+
+    //the two integrators of the state variable filter
+    SIMDFloat ic1[2], ic2[2];
+
+    void reset();
+    void resetLane(size_t lane);
+};
+
 class FrequencyFilter 
 {
 public:
     enum FilterType {
-        LOWPASS, HIGHPASS
+        LOWPASS, HIGHPASS, BANDPASS, NOTCH
+    };
+
+    //the biquad is the cheaper of the two, but it can only be low-pass or high-pass, and its coefficients can't
+    //move far in one go without it ringing. The state variable filter is a topology-preserving one, which stays
+    //well behaved however fast its cutoff is swept. Band-pass and notch always use the state variable filter
+    enum FilterStructure {
+        BIQUAD, STATE_VARIABLE
     };
 
     enum FilterType type;
+    enum FilterStructure structure;
     double centreFrequency;
     double resonance;
     Envelope env;
-    double currentLFOAngle;
+    juce::uint32 currentLFOPhase;       //as an Oscillator::Phase
 
     FrequencyFilter(NEASynthesiserAudioProcessor&);
 
-    std::vector<std::vector<float>> filterAudio(std::vector<std::vector<float>> inputAudio
-        , int currentSampleIndex, bool isNoteOn, std::vector<std::vector<float>> lastTwoInputSamples,
-        std::vector<std::vector<float>> lastTwoOutputSamples, double& releaseFrequency);
+    bool isStateVariable() const;
+
+    //works out the coefficients for a voice whose envelope is at the given centre frequency. The filter LFO is
+    //applied on top of that here, at the given LFO phase (an Oscillator::Phase). They are read from the processor's
+    //FilterTable, so this is cheap enough to do for every voice at every control point
+    void getCoefficients(double frequency, juce::uint32 lfoPhase, float& c1, float& c2, float& c3, float& c4) const;
+
+    //how much of the input, band-pass and low-pass outputs of the state variable filter make up the output
+    void getStateVariableMix(float& inputGain, float& bandGain, float& lowGain) const;
 
-    double getCurrentCentreFrequency(int currentSampleIndex, bool isNoteOn, double& releaseFrequency);
+    //the centre frequency with the envelope at envelopeLevel (see Envelope::getLevel()). The release takes the
+    //envelope back down from wherever it was, so the frequency heads back to the cutoff the same way
+    double getCentreFrequency(double envelopeLevel) const;
 
 private:
     NEASynthesiserAudioProcessor& parentProcessor;
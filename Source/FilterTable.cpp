@@ -0,0 +1,150 @@
+/*
+  ==============================================================================
+
+    FilterTable.cpp
+    Created: 17 Oct 2026 8:02:19am
+    Author:  user
+
+  ==============================================================================
+*/
+
+#include "FilterTable.h"
+#include <cmath>
+
+FilterTable::FilterTable() : builtSampleRate(0.0) {
+    log2TopFrequency = std::log2(maxFrequency);
+    log2MaxResonance = std::log2(maxResonance);
+}
+
+bool FilterTable::isBuilt() const {
+    return builtSampleRate > 0.0;
+}
+
+FilterTable::Point FilterTable::getExactPoint(double frequency, double resonance, double sampleRate) {
+    // This algorithm is simply a code implementation of the algorithm found here:
+    // https://webaudio.github.io/Audio-EQ-Cookbook/audio-eq-cookbook.html
+    double omega = juce::MathConstants<double>::twoPi * frequency / sampleRate;
+    double alpha = std::sin(omega) / (2 * resonance);
+    double cosOmega = std::cos(omega);
+    double a0 = 1 + alpha;
+
+    Point point;
+    point.lowPassGain = static_cast<float>((1 - cosOmega) / a0);
+    point.highPassGain = static_cast<float>((1 + cosOmega) / a0);
+    point.c3 = static_cast<float>((-2 * cosOmega) / a0);
+    point.c4 = static_cast<float>((1 - alpha) / a0);
+
+    return point;
+}
+
+FilterTable::StateVariablePoint FilterTable::getExactStateVariablePoint(double frequency, double resonance,
+    double sampleRate) {
+    // This is the state variable filter from Andrew Simper's "Linear Trapezoidal Integrated State Variable Filter"
+    // paper: https://cytomic.com/files/dsp/SvfLinearTrapOptimised2.pdf
+    double g = std::tan(juce::MathConstants<double>::pi * frequency / sampleRate);
+    double k = 1 / resonance;
+    double a1 = 1 / (1 + g * (g + k));
+
+    StateVariablePoint point;
+    point.a1 = static_cast<float>(a1);
+    point.a2 = static_cast<float>(g * a1);
+    point.a3 = static_cast<float>(g * g * a1);
+
+    return point;
+}
+
+void FilterTable::build(double sampleRate) {
+    if (builtSampleRate == sampleRate) {
+        return;
+    }
+
+    points.resize(static_cast<size_t>(numResonances * numFrequencies));
+    stateVariablePoints.resize(static_cast<size_t>(numResonances * numFrequencies));
+
+    double topFrequency = juce::jmin(maxFrequency, nyquistFraction * sampleRate);
+    log2TopFrequency = std::log2(topFrequency);
+
+    for (int r = 0; r < numResonances; ++r) {
+        double resonance = maxResonance * std::exp2(static_cast<double>(r - numResonances + 1) /
+            resonancePointsPerOctave);
+
+        for (int f = 0; f < numFrequencies; ++f) {
+            double frequency = topFrequency * std::exp2(static_cast<double>(f - numFrequencies + 1) /
+                frequencyPointsPerOctave);
+
+            auto index = static_cast<size_t>(r * numFrequencies + f);
+
+            points[index] = getExactPoint(frequency, resonance, sampleRate);
+            stateVariablePoints[index] = getExactStateVariablePoint(frequency, resonance, sampleRate);
+        }
+    }
+
+    builtSampleRate = sampleRate;
+}
+
+FilterTable::GridPosition FilterTable::getGridPosition(double log2Frequency, double log2Resonance) const {
+    //where the point is on the grid, counted from the top corner so that the edges are easy to clamp to
+    double f = juce::jlimit(0.0, static_cast<double>(numFrequencies - 1),
+        (log2Frequency - log2TopFrequency) * frequencyPointsPerOctave + (numFrequencies - 1));
+    double r = juce::jlimit(0.0, static_cast<double>(numResonances - 1),
+        (log2Resonance - log2MaxResonance) * resonancePointsPerOctave + (numResonances - 1));
+
+    //the last point on each side is read as the one before it with a fraction of 1, so that there is always a
+    //next point to read
+    int fIndex = juce::jmin(static_cast<int>(f), numFrequencies - 2);
+    int rIndex = juce::jmin(static_cast<int>(r), numResonances - 2);
+
+    GridPosition position;
+    position.index = rIndex * numFrequencies + fIndex;
+    position.frequencyFraction = static_cast<float>(f - fIndex);
+    position.resonanceFraction = static_cast<float>(r - rIndex);
+
+    return position;
+}
+
+FilterTable::Point FilterTable::lookUp(double log2Frequency, double log2Resonance) const {
+    GridPosition position = getGridPosition(log2Frequency, log2Resonance);
+    auto fFraction = position.frequencyFraction;
+    auto rFraction = position.resonanceFraction;
+
+    const Point* low = points.data() + position.index;
+    const Point* high = low + numFrequencies;
+
+    auto mix = [fFraction, rFraction](float lowLow, float lowHigh, float highLow, float highHigh) {
+        float lowResonance = lowLow + fFraction * (lowHigh - lowLow);
+        float highResonance = highLow + fFraction * (highHigh - highLow);
+
+        return lowResonance + rFraction * (highResonance - lowResonance);
+    };
+
+    Point point;
+    point.lowPassGain = mix(low[0].lowPassGain, low[1].lowPassGain, high[0].lowPassGain, high[1].lowPassGain);
+    point.highPassGain = mix(low[0].highPassGain, low[1].highPassGain, high[0].highPassGain, high[1].highPassGain);
+    point.c3 = mix(low[0].c3, low[1].c3, high[0].c3, high[1].c3);
+    point.c4 = mix(low[0].c4, low[1].c4, high[0].c4, high[1].c4);
+
+    return point;
+}
+
+FilterTable::StateVariablePoint FilterTable::lookUpStateVariable(double log2Frequency, double log2Resonance) const {
+    GridPosition position = getGridPosition(log2Frequency, log2Resonance);
+    auto fFraction = position.frequencyFraction;
+    auto rFraction = position.resonanceFraction;
+
+    const StateVariablePoint* low = stateVariablePoints.data() + position.index;
+    const StateVariablePoint* high = low + numFrequencies;
+
+    auto mix = [fFraction, rFraction](float lowLow, float lowHigh, float highLow, float highHigh) {
+        float lowResonance = lowLow + fFraction * (lowHigh - lowLow);
+        float highResonance = highLow + fFraction * (highHigh - highLow);
+
+        return lowResonance + rFraction * (highResonance - lowResonance);
+    };
+
+    StateVariablePoint point;
+    point.a1 = mix(low[0].a1, low[1].a1, high[0].a1, high[1].a1);
+    point.a2 = mix(low[0].a2, low[1].a2, high[0].a2, high[1].a2);
+    point.a3 = mix(low[0].a3, low[1].a3, high[0].a3, high[1].a3);
+
+    return point;
+}
@@ -0,0 +1,85 @@
+/*
+  ==============================================================================
+
+    FilterTable.h
+    Created: 17 Oct 2026 8:02:06am
+    Author:  user
+
+  ==============================================================================
+*/
+
+#pragma once
+#include <JuceHeader.h>
+#include <vector>
+
+//the parts of the filter coefficients that need a sine, a cosine (or a tan) and a division, worked out ahead of time
+//at every cutoff frequency and resonance on a grid. Both are spaced out evenly in octaves, since that is how far apart two
+//settings sound. The filter reads in between the four nearest points on the grid, and a mix of stable filters is
+//stable as well, so whatever it reads can't blow up
+class FilterTable {
+public:
+    //the grid goes up to maxFrequency, or to nyquistFraction of the sample rate if that is lower. At the Nyquist
+    //frequency tan(pi * frequency / sampleRate) goes to infinity and above it the filters are unstable, so a cutoff
+    //that high is held at the top of the grid
+    static constexpr double maxFrequency = 20000.0;
+    static constexpr double nyquistFraction = 0.45;
+    static constexpr int numFrequencyOctaves = 11;          //down to under 10Hz, which the filter LFO can reach
+    static constexpr int frequencyPointsPerOctave = 64;
+    static constexpr int numFrequencies = numFrequencyOctaves * frequencyPointsPerOctave + 1;
+
+    static constexpr double maxResonance = 10.0;
+    static constexpr int numResonanceOctaves = 7;           //down to 0.078, under the lowest the parameter goes
+    static constexpr int resonancePointsPerOctave = 8;
+    static constexpr int numResonances = numResonanceOctaves * resonancePointsPerOctave + 1;
+
+    //what is kept at each point. The low-pass and high-pass filters share c3 and c4, and each gets its c1 and c2
+    //from its own gain (see FrequencyFilter::getCoefficients())
+    struct Point {
+        float lowPassGain;      //(1 - cos(omega)) / a0
+        float highPassGain;     //(1 + cos(omega)) / a0
+        float c3;
+        float c4;
+    };
+
+    //the same for the state variable filter, where g = tan(pi * frequency / sampleRate) and k = 1 / resonance.
+    //These are all it needs, and are the same whichever of its outputs is used
+    struct StateVariablePoint {
+        float a1;       //1 / (1 + g * (g + k))
+        float a2;       //g * a1
+        float a3;       //g * a2
+    };
+
+    FilterTable();
+
+    //fills in the grid for a sample rate. This allocates, so it is done in prepareToPlay(), and does nothing if the
+    //grid is already there for that sample rate
+    void build(double sampleRate);
+    bool isBuilt() const;
+
+    //the point for a cutoff of 2^log2Frequency Hz and a resonance of 2^log2Resonance. Anything off the edge of the
+    //grid gets the nearest edge
+    Point lookUp(double log2Frequency, double log2Resonance) const;
+    StateVariablePoint lookUpStateVariable(double log2Frequency, double log2Resonance) const;
+
+    //the same worked out exactly, which is what the grid is filled in with
+    static Point getExactPoint(double frequency, double resonance, double sampleRate);
+    static StateVariablePoint getExactStateVariablePoint(double frequency, double resonance, double sampleRate);
+
+private:
+    //both grids are [resonance][frequency]
+    std::vector<Point> points;
+    std::vector<StateVariablePoint> stateVariablePoints;
+    double builtSampleRate;
+    double log2TopFrequency;        //for the sample rate the grid was built for
+    double log2MaxResonance;
+
+    //where a frequency and resonance are on the grid. index is the point below and to the left of them, and the
+    //fractions are how far they are towards the next point along each side
+    struct GridPosition {
+        int index;
+        float frequencyFraction;
+        float resonanceFraction;
+    };
+
+    GridPosition getGridPosition(double log2Frequency, double log2Resonance) const;
+};
@@ -9,6 +9,7 @@
 */
 
 #pragma once
+#include <JuceHeader.h>
 
 class LFO {
 public:
@@ -19,5 +20,10 @@ public:
     double rate;
     double amount;
     enum DestinationType destination;
+
+    //how far the LFO moves on every sample, worked out from the rate at the start of each block. It is in the same
+    //32 bit fixed point as Oscillator::Phase, so the LFO phases are moved on exactly and end up in the same place
+    //however the block is split up
+    juce::uint32 phaseDelta;
 };
 
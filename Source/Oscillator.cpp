@@ -10,84 +10,80 @@
 
 #include "Oscillator.h"
 #include "PluginProcessor.h"
+#include "FastMath.h"
 #include <cmath>
-#define TWELFTH_ROOT_OF_TWO 1.05946309436f
 
-//square wave function with period of twoPi
-double square(double angle) {
-    //takes modulus of angle with respect to twoPi, essentially finding the remainder when angle is divided by twoPi
-    angle = std::fmodl(angle, juce::MathConstants<double>::twoPi);
-
-    if (angle <= juce::MathConstants<double>::pi) {
-        return 1.0;
+//the difference between a sharp jump of 2 at phase 0 and a band-limited one, for a waveform whose phase (in cycles)
+//goes up by phaseDelta every sample. It is added for a jump up and taken away for a jump down, and it is only
+//non-zero within one sample either side of the jump
+static inline float polyBLEP(float phase, float phaseDelta, float inversePhaseDelta) {
+    if (phase < phaseDelta) {
+        float x = phase * inversePhaseDelta;
+        return x + x - x * x - 1.0f;
     }
-    else {
-        return -1.0;
+    else if (phase > 1.0f - phaseDelta) {
+        float x = (phase - 1.0f) * inversePhaseDelta;
+        return x * x + x + x + 1.0f;
     }
-}
-
-//saw wave function with period of twoPi
-double saw(double angle) {
-    //remainder when angle is divided by twoPi
-    angle = std::fmodl(angle, juce::MathConstants<double>::twoPi);
-
-    double value = angle / juce::MathConstants<double>::pi;
 
-    if (angle <= juce::MathConstants<double>::pi) {
-        return value;
-    }
-    else {
-        return value - 2.0;
-    }
+    return 0.0f;
 }
 
-//array of function pointers.
-double (*wave[3])(double) = { &std::sin, &square, &saw };
-
-
 Oscillator::Oscillator(NEASynthesiserAudioProcessor& p) : parentProcessor(p) {
     type = SINE;
+    mode = WAVETABLE;
     volume = 0.0f;
     coarsePitch = 0;
     finePitch = 0;
     pan = 0;
     phaseOffset = 0;
+    unison = 1;
+    unisonSpread = 0;
+    unisonWidth = 0;
 }
 
-std::vector<std::vector<float>> Oscillator::generateAudio(int blockSize, int midiNote, int& startSample, double& currentAngle,
-    double& currentLFOAngle, bool isNoteOn) const {
+Oscillator::Phase Oscillator::getPhaseDelta(int midiNote, Phase currentLFOPhase) const {
+    //the pitch is worked out in octaves above A4 (440Hz), so that the fine pitch and the LFO can be added on and
+    //there is only one power of 2 to work out at the end
+    double octaves = (midiNote + coarsePitch - 69 + finePitch / 100.0) / 12.0;
 
-    //the way the panning works is that it just reduces the volume of one of the channels. At 0 panning, both channels will be at
-    //maximum volume
-    double leftChannelVolume = 1;
-    double rightChannelVolume = 1;
+    //dealing with the lfo here. It multiplies the frequency by lfo.amount to the power of the sine, which is the
+    //same as adding log2(lfo.amount) times the sine to the octaves
+    if (parentProcessor.lfo.destination == parentProcessor.lfo.PITCH) {
+        octaves += FastMath::log2(parentProcessor.lfo.amount) * FastMath::sin2Pi(phaseToCycles(currentLFOPhase));
+    }
 
-    double frequency = juce::MidiMessage::getMidiNoteInHertz(midiNote + coarsePitch);
-    frequency *= std::pow(TWELFTH_ROOT_OF_TWO, finePitch / 100.0f);
+    double frequency = 440.0 * FastMath::exp2(octaves);
 
-    //dealing with the lfo here
-    if (parentProcessor.lfo.destination == parentProcessor.lfo.PITCH) {
-        //lfo equation
-        double lfoFactor = std::pow(parentProcessor.lfo.amount, std::sin(currentLFOAngle));
-        frequency *= lfoFactor;
+    //a note above the sample rate (which can only happen with the LFO) is folded back down, the same as it would
+    //be if it was sampled
+    return cyclesToPhase(frequency / parentProcessor.sampleRate);
+}
 
-        int numSamples;
+Oscillator::Phase Oscillator::getPhaseOffset() const {
+    return cyclesToPhase(phaseOffset / juce::MathConstants<double>::twoPi);
+}
 
-        if (isNoteOn) {
-            numSamples = blockSize - startSample;
-        }
-        else {
-            numSamples = blockSize;
-        }
+Oscillator::Phase Oscillator::cyclesToPhase(double cycles) {
+    cycles -= std::floor(cycles);
 
-        double lfoAngleDelta = juce::MathConstants<double>::twoPi * (parentProcessor.lfo.rate / parentProcessor.sampleRate) *
-            (numSamples);
+    //rounding can make it come out at exactly phasesPerCycle, which the cast to 32 bits then wraps round to 0
+    return static_cast<Phase>(static_cast<juce::uint64>(cycles * phasesPerCycle + 0.5));
+}
 
-        currentLFOAngle += lfoAngleDelta;
-    }
+double Oscillator::phaseToCycles(Phase phase) {
+    return phase / phasesPerCycle;
+}
+
+void Oscillator::getChannelVolumes(float& leftChannelVolume, float& rightChannelVolume) const {
+    getPannedVolumes(pan, volume, leftChannelVolume, rightChannelVolume);
+}
 
-    double cyclesPerSample = frequency / parentProcessor.sampleRate;
-    double angleDelta = juce::MathConstants<double>::twoPi * cyclesPerSample;
+void Oscillator::getPannedVolumes(double pan, double volume, float& leftChannelVolume, float& rightChannelVolume) {
+    //the way the panning works is that it just reduces the volume of one of the channels. At 0 panning, both channels will be at
+    //maximum volume
+    leftChannelVolume = 1;
+    rightChannelVolume = 1;
 
     if (pan < 0) {
         //decrease rightChannelVolume
@@ -100,32 +96,132 @@ std::vector<std::vector<float>> Oscillator::generateAudio(int blockSize, int mid
 
     leftChannelVolume = leftChannelVolume * volume;
     rightChannelVolume = rightChannelVolume * volume;
+}
 
-    std::vector<float> leftChannelOutput(blockSize, 0.0f);    //creates an array with a size of blockSize
-    std::vector<float> rightChannelOutput(blockSize, 0.0f);   //creates an array with a size of blockSize
+void Oscillator::getUnisonStack(UnisonStack& stack) const {
+    stack.numCopies = unison;
 
-    double currentAngleWithPhase = currentAngle + phaseOffset;
-    
-    if (!isNoteOn) {    //equivalent to (isNoteOn == false)
-        for (int i = 0; i < startSample; ++i) {
-            leftChannelOutput[i] = (wave[type])(currentAngleWithPhase) * leftChannelVolume;
-            rightChannelOutput[i] = (wave[type])(currentAngleWithPhase) * rightChannelVolume;
-            currentAngleWithPhase += angleDelta;
+    //the copies are turned down so that the whole stack is about as loud as one oscillator
+    double copyVolume = volume / std::sqrt(static_cast<double>(unison));
+
+    for (int copy = 0; copy < maxUnison; ++copy) {
+        if (copy >= unison) {
+            stack.pitchRatio[copy] = 0.0f;
+            stack.leftVolume[copy] = 0.0f;
+            stack.rightVolume[copy] = 0.0f;
+            continue;
         }
+
+        //where the copy is in the stack, from -1 for the lowest to 1 for the highest
+        double position = unison == 1 ? 0.0 : 2.0 * copy / (unison - 1) - 1.0;
+        double copyPan = juce::jlimit(-1.0, 1.0, pan + position * unisonWidth);
+
+        stack.pitchRatio[copy] = static_cast<float>(FastMath::exp2(position * unisonSpread / 2400.0));
+        getPannedVolumes(copyPan, copyVolume, stack.leftVolume[copy], stack.rightVolume[copy]);
     }
+}
+
+Oscillator::Phase Oscillator::getUnisonStartPhase(int copy) {
+    //stepping round the circle by the golden ratio (2^32 / 1.618...) never lands two copies near each other. The
+    //first copy starts at 0 like a note without unison does
+    return static_cast<Phase>(copy) * 2654435769u;
+}
+
+void Oscillator::generateWaveform(const Phase* phases, float* output, int numSamples, const Phase* lanePhaseDeltas,
+    int numLanes) const {
+    //[mode][type]. The sine is always read from the table, whichever mode is chosen
+    static constexpr WaveformKernel kernels[3][3] = {
+        { &Oscillator::generateTableWaveform, &Oscillator::generateTableWaveform, &Oscillator::generateTableWaveform },
+        { &Oscillator::generateTableWaveform, &Oscillator::generatePolyBLEPWaveform<SQUARE>,
+            &Oscillator::generatePolyBLEPWaveform<SAW> },
+        { &Oscillator::generateTableWaveform, &Oscillator::generateNaiveWaveform<SQUARE>,
+            &Oscillator::generateNaiveWaveform<SAW> }
+    };
+
+    (this->*kernels[mode][type])(phases, output, numSamples, lanePhaseDeltas, numLanes);
+}
+
+void Oscillator::generateTableWaveform(const Phase* phases, float* output, int numSamples,
+    const Phase* lanePhaseDeltas, int numLanes) const {
+    auto& wavetables = parentProcessor.wavetables;
+
+    jassert(wavetables.isBuilt());
 
-    for (int i = startSample; i < blockSize; ++i) {
-        leftChannelOutput[i] = (wave[type])(currentAngleWithPhase) * leftChannelVolume;
-        rightChannelOutput[i] = (wave[type])(currentAngleWithPhase) * rightChannelVolume;
-        currentAngleWithPhase += angleDelta;
+    //each lane has its own pitch, so each one gets the table that suits it
+    const float* tables[maxLanes];
+
+    for (int lane = 0; lane < numLanes; ++lane) {
+        tables[lane] = getTable(lanePhaseDeltas[lane]);
     }
 
-    startSample = 0;
-    currentAngle = currentAngleWithPhase - phaseOffset;
-    
-    std::vector<std::vector<float>> output(2, {0.0f});
-    output[0] = leftChannelOutput;
-    output[1] = rightChannelOutput;
-    return output;
+    for (int i = 0; i < numSamples; i += numLanes) {
+        for (int lane = 0; lane < numLanes; ++lane) {
+            output[i + lane] = Wavetables::lookUp(tables[lane], phases[i + lane]);
+        }
+    }
 }
 
+const float* Oscillator::getTable(Phase phaseDelta) const {
+    return parentProcessor.wavetables.getTable(type, static_cast<float>(phaseDelta / phasesPerCycle));
+}
+
+template <Oscillator::OscillatorType waveType>
+void Oscillator::generatePolyBLEPWaveform(const Phase* phases, float* output, int numSamples,
+    const Phase* lanePhaseDeltas, int numLanes) const {
+    const auto cyclesPerPhase = static_cast<float>(1.0 / phasesPerCycle);
+    const Phase halfCycle = 0x80000000u;
+
+    float phaseDeltas[maxLanes];
+    float inversePhaseDeltas[maxLanes];
+
+    for (int lane = 0; lane < numLanes; ++lane) {
+        //the corrections from either side of a jump would overlap above half the sample rate
+        phaseDeltas[lane] = juce::jmin(0.5f, static_cast<float>(lanePhaseDeltas[lane]) * cyclesPerPhase);
+        inversePhaseDeltas[lane] = phaseDeltas[lane] > 0.0f ? 1.0f / phaseDeltas[lane] : 0.0f;
+    }
+
+    for (int i = 0; i < numSamples; i += numLanes) {
+        for (int lane = 0; lane < numLanes; ++lane) {
+            Phase fixedPhase = phases[i + lane];
+            float phase = static_cast<float>(fixedPhase) * cyclesPerPhase;
+            float phaseDelta = phaseDeltas[lane];
+            float inversePhaseDelta = inversePhaseDeltas[lane];
+
+            //shifted by half a cycle, so that the jump from 1 to -1 at pi is at 0
+            float halfPhase = static_cast<float>(static_cast<Phase>(fixedPhase + halfCycle)) * cyclesPerPhase;
+
+            if constexpr (waveType == SQUARE) {
+                //1 for the first half of the cycle and -1 for the second, jumping up at 0 and down at pi
+                float value = fixedPhase < halfCycle ? 1.0f : -1.0f;
+                output[i + lane] = value + polyBLEP(phase, phaseDelta, inversePhaseDelta) -
+                    polyBLEP(halfPhase, phaseDelta, inversePhaseDelta);
+            }
+            else {      //SAW
+                //goes from 0 up to 1 at pi, jumps to -1 and goes back up to 0
+                output[i + lane] = 2.0f * halfPhase - 1.0f - polyBLEP(halfPhase, phaseDelta, inversePhaseDelta);
+            }
+        }
+    }
+}
+
+template <Oscillator::OscillatorType waveType>
+void Oscillator::generateNaiveWaveform(const Phase* phases, float* output, int numSamples,
+    const Phase* lanePhaseDeltas, int numLanes) const {
+    const auto cyclesPerPhase = static_cast<float>(1.0 / phasesPerCycle);
+    const Phase halfCycle = 0x80000000u;
+
+    //the same waveforms as generatePolyBLEPWaveform() without the corrections, so the lanes don't matter here
+    juce::ignoreUnused(lanePhaseDeltas, numLanes);
+
+    for (int i = 0; i < numSamples; ++i) {
+        Phase fixedPhase = phases[i];
+
+        if constexpr (waveType == SQUARE) {
+            output[i] = fixedPhase < halfCycle ? 1.0f : -1.0f;
+        }
+        else {      //SAW
+            float halfPhase = static_cast<float>(static_cast<Phase>(fixedPhase + halfCycle)) * cyclesPerPhase;
+            output[i] = 2.0f * halfPhase - 1.0f;
+        }
+    }
+}
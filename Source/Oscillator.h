@@ -11,7 +11,6 @@
 #pragma once
 
 #include <JuceHeader.h>
-#include <vector>
 
 class NEASynthesiserAudioProcessor;
 
@@ -23,19 +22,94 @@ public:
         SINE, SQUARE, SAW
     };
 
+    //how the square and saw are kept from aliasing. WAVETABLE reads them from the band-limited tables, and POLYBLEP
+    //works out the plain waveform and smooths over each jump with a small polynomial. NAIVE is the plain waveform
+    //with nothing done about aliasing, which is the cheapest, and is only used at the Eco quality. The sine is
+    //always read from the table
+    enum WaveformMode {
+        WAVETABLE, POLYBLEP, NAIVE
+    };
+
+    //the phase of a note is a 32 bit fraction of a cycle, where 0 is the start of the cycle and phasesPerCycle would
+    //be the end. Adding to it wraps back round to the start by itself, and it is just as precise at any point in
+    //the cycle, so the pitch stays exactly the same however long a note is held
+    using Phase = juce::uint32;
+    static constexpr double phasesPerCycle = 4294967296.0;
+
+    static constexpr int maxUnison = 16;
+    static constexpr int maxLanes = 16;         //the most notes that generateWaveform() can be given at once
+
+    //the pitch and channel volumes of every unison copy, worked out once per block. The entries past the last copy
+    //are 0, so the voices can always work through a whole number of SIMDRegisters of copies
+    struct UnisonStack {
+        alignas(juce::dsp::SIMDRegister<float>) float pitchRatio[maxUnison];   //relative to the note's pitch
+        alignas(juce::dsp::SIMDRegister<float>) float leftVolume[maxUnison];
+        alignas(juce::dsp::SIMDRegister<float>) float rightVolume[maxUnison];
+        int numCopies;
+    };
+
     enum OscillatorType type;
+    enum WaveformMode mode;
     double volume;              //float between 0 and 1
     int coarsePitch;            //integer between -12 and 12 inclusive
     int finePitch;              //integer between -100 and 100 inclusive (because it is measured in cents)
     double pan;                 //float between -1 and 1 inclusive;
     double phaseOffset;
+    int unison;                 //integer between 1 and maxUnison inclusive, the number of detuned copies played
+    double unisonSpread;        //how far apart the lowest and highest copies are, in cents
+    double unisonWidth;         //float between 0 and 1, how far the copies are panned away from each other
 
     
     Oscillator(NEASynthesiserAudioProcessor&);
 
-    std::vector<std::vector<float>> generateAudio(int blockSize, int midiNote, int& startSample, double& currentAngle,
-        double& currentLFOAngle, bool isNoteOn) const;
+    //the amount the phase of a note increases by each sample. This includes the pitch LFO at the given LFO phase
+    Phase getPhaseDelta(int midiNote, Phase currentLFOPhase) const;
+
+    //the phase offset parameter (in radians) as a Phase, which can just be added onto a note's phase
+    Phase getPhaseOffset() const;
+
+    //turns a number of cycles into a Phase, leaving out any whole cycles, and back again
+    static Phase cyclesToPhase(double cycles);
+    static double phaseToCycles(Phase phase);
+
+    //the volume of each channel once the panning has been applied
+    void getChannelVolumes(float& leftChannelVolume, float& rightChannelVolume) const;
+
+    //the copies are detuned evenly across the spread and panned evenly across the width, lowest on the left
+    void getUnisonStack(UnisonStack& stack) const;
+
+    //the phase each copy starts a note at. The copies start at different phases so that they don't all line up
+    //at the start of the note and sound like one loud oscillator
+    static Phase getUnisonStartPhase(int copy);
+
+    //writes the value of this oscillator's waveform at each of the phases into output. The voices advance the
+    //phases themselves, several at a time, so this is the only per-sample work left in here. The phases belong to
+    //numLanes different notes in turn, and lanePhaseDeltas has the fastest each note goes, which decides which of
+    //the band-limited tables it is read from
+    void generateWaveform(const Phase* phases, float* output, int numSamples, const Phase* lanePhaseDeltas,
+        int numLanes) const;
+
+    //the band-limited table of this oscillator's waveform for a note whose phase goes up by phaseDelta every
+    //sample, for reading one sample at a time with Wavetables::lookUp(). The tables have to have been built
+    const float* getTable(Phase phaseDelta) const;
 
 private:
     NEASynthesiserAudioProcessor& parentProcessor;
+
+    //generateWaveform() picks one of these for the type and mode once per call, so the loops inside them never
+    //have to check either
+    using WaveformKernel = void (Oscillator::*)(const Phase*, float*, int, const Phase*, int) const;
+
+    void generateTableWaveform(const Phase* phases, float* output, int numSamples, const Phase* lanePhaseDeltas,
+        int numLanes) const;
+
+    template <OscillatorType waveType>
+    void generatePolyBLEPWaveform(const Phase* phases, float* output, int numSamples, const Phase* lanePhaseDeltas,
+        int numLanes) const;
+
+    template <OscillatorType waveType>
+    void generateNaiveWaveform(const Phase* phases, float* output, int numSamples, const Phase* lanePhaseDeltas,
+        int numLanes) const;
+
+    static void getPannedVolumes(double pan, double volume, float& leftChannelVolume, float& rightChannelVolume);
 };
@@ -45,6 +45,8 @@ NEASynthesiserAudioProcessorEditor::NEASynthesiserAudioProcessorEditor (NEASynth
 
     filterType.addItem("Low-pass", 1);
     filterType.addItem("High-pass", 2);
+    filterType.addItem("Band-pass", 3);
+    filterType.addItem("Notch", 4);
 
     LFODest.addItem("Pitch", 1);
     LFODest.addItem("Filter", 2);
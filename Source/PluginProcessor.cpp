@@ -27,10 +27,18 @@ NEASynthesiserAudioProcessor::NEASynthesiserAudioProcessor()
     filter(*this),
     apvts(*this, nullptr, "parameters", createParameters())
 {
+    sampleRate = 44100.0;
+    hostSampleRate = 44100.0;
+    quality = NORMAL;
+    oversampling = 1;
+
+    apvts.addParameterListener("MULTITHREADING", this);
 }
 
 NEASynthesiserAudioProcessor::~NEASynthesiserAudioProcessor()
 {
+    apvts.removeParameterListener("MULTITHREADING", this);
+    cancelPendingUpdate();
 }
 
 //==============================================================================
@@ -100,13 +108,46 @@ void NEASynthesiserAudioProcessor::prepareToPlay (double sampleRate, int samples
 {
     // Use this method as the place to do any pre-playback
     // initialisation that you need..
-    this->sampleRate = sampleRate;
+    hostSampleRate = sampleRate;
+    this->sampleRate = sampleRate * oversampling;
+
+    //all of the scratch memory used while rendering is allocated here rather than in processBlock, with room for
+    //the block at the highest quality. The oscillator tables are only built the first time, and the filter tables
+    //are built again if the sample rate changes
+    voiceArr.prepare(samplesPerBlock * maxOversampling);
+    voiceArr.setThreadsRunning(isMultithreadingOn());
+    oversampledBuffer.setSize(2, samplesPerBlock * maxOversampling);
+    downsampler.reset();
+    wavetables.build();
+    filterTable.build(sampleRate);
+    oversampledFilterTable.build(sampleRate * maxOversampling);
+}
+
+const FilterTable& NEASynthesiserAudioProcessor::getFilterTable() const
+{
+    return oversampling > 1 ? oversampledFilterTable : filterTable;
 }
 
 void NEASynthesiserAudioProcessor::releaseResources()
 {
     // When playback stops, you can use this as an opportunity to free up any
     // spare memory, etc.
+    voiceArr.releaseResources();
+}
+
+void NEASynthesiserAudioProcessor::parameterChanged(const juce::String&, float)
+{
+    triggerAsyncUpdate();
+}
+
+void NEASynthesiserAudioProcessor::handleAsyncUpdate()
+{
+    voiceArr.setThreadsRunning(isMultithreadingOn());
+}
+
+bool NEASynthesiserAudioProcessor::isMultithreadingOn() const
+{
+    return apvts.getRawParameterValue("MULTITHREADING")->load() > 0.5f;
 }
 
 #ifndef JucePlugin_PreferredChannelConfigurations
@@ -159,7 +200,29 @@ void NEASynthesiserAudioProcessor::processBlock (juce::AudioBuffer<float>& buffe
 
     //My code from below here--------------------------------------------------------------------------
 
+    //prepareToPlay() builds the tables before any audio is asked for. The voices read them without checking, so a
+    //host that gets this wrong is given silence instead
+    jassert(wavetables.isBuilt() && filterTable.isBuilt() && oversampledFilterTable.isBuilt());
+
+    if (!wavetables.isBuilt() || !filterTable.isBuilt() || !oversampledFilterTable.isBuilt()) {
+        buffer.clear();
+        return;
+    }
+
     //retrieving values from the GUI elements:
+        //the quality comes first, since it decides the rate that everything below is worked out at. The
+        //downsampler's history is from before the quality last changed, so it starts again from silence
+        quality = (Quality) (apvts.getRawParameterValue("QUALITY")->load());
+        int previousOversampling = oversampling;
+        int newOversampling = quality == HIGH ? maxOversampling : 1;
+
+        if (newOversampling != oversampling) {
+            oversampling = newOversampling;
+            downsampler.reset();
+        }
+
+        sampleRate = hostSampleRate * oversampling;
+
         osc1.type = (Oscillator::OscillatorType) (apvts.getRawParameterValue("OSC1_TYPE")->load());
         
         osc1.volume = apvts.getRawParameterValue("OSC1_VOL")->load() * 0.25f;
@@ -167,6 +230,11 @@ void NEASynthesiserAudioProcessor::processBlock (juce::AudioBuffer<float>& buffe
         osc1.finePitch = apvts.getRawParameterValue("OSC1_FP")->load();
         osc1.pan = apvts.getRawParameterValue("OSC1_PAN")->load();
         osc1.phaseOffset = apvts.getRawParameterValue("OSC1_PO")->load();
+        osc1.unison = apvts.getRawParameterValue("OSC1_UNISON")->load();
+        osc1.unisonSpread = apvts.getRawParameterValue("OSC1_SPREAD")->load();
+        osc1.unisonWidth = apvts.getRawParameterValue("OSC1_WIDTH")->load();
+        osc1.mode = quality == ECO ? Oscillator::NAIVE :
+            (Oscillator::WaveformMode) (apvts.getRawParameterValue("OSC1_MODE")->load());
 
 
         //osc2.type = (Oscillator::OscillatorType)editor->osc2type.getSelectedId();
@@ -176,14 +244,23 @@ void NEASynthesiserAudioProcessor::processBlock (juce::AudioBuffer<float>& buffe
         osc2.finePitch = apvts.getRawParameterValue("OSC2_FP")->load();
         osc2.pan = apvts.getRawParameterValue("OSC2_PAN")->load();
         osc2.phaseOffset = apvts.getRawParameterValue("OSC2_PO")->load();
+        osc2.unison = apvts.getRawParameterValue("OSC2_UNISON")->load();
+        osc2.unisonSpread = apvts.getRawParameterValue("OSC2_SPREAD")->load();
+        osc2.unisonWidth = apvts.getRawParameterValue("OSC2_WIDTH")->load();
+        osc2.mode = quality == ECO ? Oscillator::NAIVE :
+            (Oscillator::WaveformMode) (apvts.getRawParameterValue("OSC2_MODE")->load());
 
         volumeEnv.attack = apvts.getRawParameterValue("VOL_ENV_ATTACK")->load() * sampleRate / 1000;
         volumeEnv.decay = apvts.getRawParameterValue("VOL_ENV_DECAY")->load() * sampleRate / 1000;
         volumeEnv.sustain = apvts.getRawParameterValue("VOL_ENV_SUSTAIN")->load();
         volumeEnv.release = apvts.getRawParameterValue("VOL_ENV_RELEASE")->load() * sampleRate / 1000;
+        volumeEnv.attackCurve = apvts.getRawParameterValue("VOL_ENV_ATTACK_CURVE")->load();
+        volumeEnv.decayCurve = apvts.getRawParameterValue("VOL_ENV_DECAY_CURVE")->load();
+        volumeEnv.releaseCurve = apvts.getRawParameterValue("VOL_ENV_RELEASE_CURVE")->load();
 
         //filter.type = (FrequencyFilter::FilterType)editor->filterType.getSelectedId();
         filter.type = (FrequencyFilter::FilterType) (apvts.getRawParameterValue("FILTER_TYPE")->load());
+        filter.structure = (FrequencyFilter::FilterStructure) (apvts.getRawParameterValue("FILTER_MODE")->load());
         filter.centreFrequency = apvts.getRawParameterValue("FILTER_CF")->load();
         filter.resonance = apvts.getRawParameterValue("FILTER_RES")->load();
 
@@ -192,17 +269,58 @@ void NEASynthesiserAudioProcessor::processBlock (juce::AudioBuffer<float>& buffe
         filter.env.decay = apvts.getRawParameterValue("FILTER_ENV_DECAY")->load() * sampleRate / 1000;
         filter.env.sustain = apvts.getRawParameterValue("FILTER_ENV_SUSTAIN")->load();
         filter.env.release = apvts.getRawParameterValue("FILTER_ENV_RELEASE")->load() * sampleRate / 1000;
+        filter.env.attackCurve = apvts.getRawParameterValue("FILTER_ENV_ATTACK_CURVE")->load();
+        filter.env.decayCurve = apvts.getRawParameterValue("FILTER_ENV_DECAY_CURVE")->load();
+        filter.env.releaseCurve = apvts.getRawParameterValue("FILTER_ENV_RELEASE_CURVE")->load();
 
         lfo.destination = (LFO::DestinationType)apvts.getRawParameterValue("LFO_DEST")->load();
         lfo.amount = apvts.getRawParameterValue("LFO_AMOUNT")->load();
         lfo.rate = apvts.getRawParameterValue("LFO_RATE")->load();
+        lfo.phaseDelta = Oscillator::cyclesToPhase(lfo.rate / sampleRate);
+
+        voiceArr.polyphony = apvts.getRawParameterValue("POLYPHONY")->load();
+        voiceArr.stealingPolicy = (SynthVoiceArray::StealingPolicy) apvts.getRawParameterValue("VOICE_STEALING")->load();
+        voiceArr.isMultithreaded = isMultithreadingOn();
+        voiceArr.crossModulation = (SynthVoiceArray::CrossModulation) apvts.getRawParameterValue("OSC_MOD")->load();
+        voiceArr.fmAmount = apvts.getRawParameterValue("OSC_FM_AMOUNT")->load();
+        voiceArr.silenceThreshold = juce::Decibels::decibelsToGain(
+            apvts.getRawParameterValue("SILENCE_THRESHOLD")->load(), -200.0f);
+        voiceArr.controlInterval = 8 << (int) apvts.getRawParameterValue("CONTROL_INTERVAL")->load();
+
+        if (quality == ECO) {
+            voiceArr.controlInterval *= 4;
+        }
+
+        //the voices that are already playing were set up at the old rate, so they are moved over to the new one
+        //now that everything above has been read at it
+        if (oversampling != previousOversampling) {
+            voiceArr.changeSampleRate(static_cast<double>(oversampling) / previousOversampling);
+        }
 
-    int timestamp = 0;          //this is when the note starts or ends, it will be passed to startSampleIndex
+    //The block is split up at the timestamp of every midi message, and the audio between two messages is
+    //rendered before the second message is applied. That way every note starts and stops on the exact sample
+    //it was played on. Messages that share a timestamp are all applied before anything else is rendered, so a
+    //chord only costs one split
+    int numSamples = buffer.getNumSamples();
+    int currentSample = 0;      //the first sample that hasn't been rendered yet
+
+    //the voices add themselves onto the buffer, so it has to start out silent. With oversampling they are
+    //rendered into oversampledBuffer instead, and every timestamp is that many times further in. It only grows if
+    //the host sends a bigger block than it said it would
+    buffer.clear();
+
+    if (oversampling > 1) {
+        if (oversampledBuffer.getNumSamples() < numSamples * oversampling) {
+            oversampledBuffer.setSize(2, numSamples * oversampling);
+        }
+
+        oversampledBuffer.clear(0, numSamples * oversampling);
+    }
+
+    juce::AudioBuffer<float>& renderBuffer = oversampling > 1 ? oversampledBuffer : buffer;
 
-    //this loop updates the SynthVoiceArray based on the new midi messages that have been input
     for (auto meta : midiMessages) {
         auto msg = meta.getMessage();
-        timestamp = meta.samplePosition;
 
         if (!msg.isNoteOnOrOff()) {
             //there are many kinds of midi messages, but the only ones that matter for this
@@ -211,52 +329,48 @@ void NEASynthesiserAudioProcessor::processBlock (juce::AudioBuffer<float>& buffe
             continue;
         }
 
-        auto noteNumber = msg.getNoteNumber();
-        auto velocity = msg.getFloatVelocity();
-
-        //find the index of the voice in the SynthVoiceArray that is playing the
-        //note given by the midi message msg
-        int index = voiceArr.find(noteNumber);
-
-        if (msg.isNoteOn()) {
-            if (index == -1) {
-                //if note is not contained in the array, then add the voice to the array
-                voiceArr.addVoice(noteNumber, velocity, timestamp);
-            }
-            else {
-                //if the note is contained in the array, then reset the voice
-                voiceArr.resetVoice(index, velocity, timestamp);
-            }
-        }
-        else {  //if the message is to turn the note off
-            if (index == -1) {
-                //if the note is not contained in the array, then do nothing
-            }
-            else {
-                //if the note is contained in the array, turn off the voice
-                voiceArr.turnOffVoice(index, timestamp);
-            }
+        //this is when the note starts or ends. Some hosts send events slightly outside of the block, so
+        //it is kept within it
+        int timestamp = juce::jlimit(currentSample, numSamples, meta.samplePosition);
+
+        if (timestamp > currentSample) {
+            renderVoices(renderBuffer, currentSample * oversampling, (timestamp - currentSample) * oversampling);
+            currentSample = timestamp;
         }
+
+        handleNoteMessage(msg);
     }
 
-    //now generate audio
-    auto output = voiceArr.generateAudio(buffer.getNumSamples());
+    if (currentSample < numSamples) {
+        renderVoices(renderBuffer, currentSample * oversampling, (numSamples - currentSample) * oversampling);
+    }
 
-    double lfoAngleDelta = juce::MathConstants<double>::twoPi * (lfo.rate / sampleRate) *
-        (buffer.getNumSamples());
+    if (oversampling > 1) {
+        for (int channel = 0; channel < juce::jmin(buffer.getNumChannels(), 2); ++channel) {
+            downsampler.process(oversampledBuffer.getReadPointer(channel), buffer.getWritePointer(channel),
+                numSamples, channel);
+        }
+    }
+}
 
-    filter.currentLFOAngle += lfoAngleDelta;
+void NEASynthesiserAudioProcessor::handleNoteMessage(const juce::MidiMessage& msg)
+{
+    //the SynthVoiceArray looks up which voice is playing the note itself, and decides which voice to steal if
+    //they are all in use
+    if (msg.isNoteOn()) {
+        voiceArr.startNote(msg.getNoteNumber(), msg.getFloatVelocity());
+    }
+    else {  //if the message is to turn the note off
+        voiceArr.stopNote(msg.getNoteNumber());
+    }
+}
 
-    //now write the audio into the buffer argument
-    for (int channel = 0; channel < totalNumOutputChannels; ++channel)
-    {
-        //for this loop, i will assume that totalNumInputChannels == totalNumOutputChannels == 2
-        auto* channelData = buffer.getWritePointer (channel);
+void NEASynthesiserAudioProcessor::renderVoices(juce::AudioBuffer<float>& buffer, int startSample, int numSamples)
+{
+    voiceArr.generateAudio(buffer, startSample, numSamples);
 
-        for (int i = 0; i < buffer.getNumSamples(); ++i) {
-            channelData[i] = output[channel][i];
-        }
-    }
+    //the filter LFO is moved on after every part of the block, so the next part sees the right phase
+    filter.currentLFOPhase += lfo.phaseDelta * static_cast<juce::uint32>(numSamples);
 }
 
 //==============================================================================
@@ -314,6 +428,14 @@ juce::AudioProcessorValueTreeState::ParameterLayout NEASynthesiserAudioProcessor
     params.push_back(std::make_unique<juce::AudioParameterFloat>("OSC1_PAN", "Osc 1 Pan", -1.0f, 1.0f, 0.0f));
     params.push_back(std::make_unique<juce::AudioParameterFloat>("OSC1_PO", "Osc 1 Phase Offset",
         -juce::MathConstants<float>::pi, juce::MathConstants<float>::pi, 0.0f));
+    params.push_back(std::make_unique<juce::AudioParameterInt>("OSC1_UNISON", "Osc 1 Unison", 1,
+        Oscillator::maxUnison, 1));
+    params.push_back(std::make_unique<juce::AudioParameterFloat>("OSC1_SPREAD", "Osc 1 Unison Spread",
+        0.0f, 100.0f, 20.0f));
+    params.push_back(std::make_unique<juce::AudioParameterFloat>("OSC1_WIDTH", "Osc 1 Unison Width",
+        0.0f, 1.0f, 1.0f));
+    params.push_back(std::make_unique<juce::AudioParameterChoice>("OSC1_MODE", "Osc 1 Anti-aliasing",
+        juce::StringArray({ "Wavetable", "PolyBLEP" }), 0));
 
     //ajdkag
 
@@ -333,6 +455,20 @@ juce::AudioProcessorValueTreeState::ParameterLayout NEASynthesiserAudioProcessor
     params.push_back(std::make_unique<juce::AudioParameterFloat>("OSC2_PAN", "Osc 2 Pan", -1.0f, 1.0f, 0.0f));
     params.push_back(std::make_unique<juce::AudioParameterFloat>("OSC2_PO", "Osc 2 Phase Offset",
         -juce::MathConstants<float>::pi, juce::MathConstants<float>::pi, 0.0f));
+    params.push_back(std::make_unique<juce::AudioParameterInt>("OSC2_UNISON", "Osc 2 Unison", 1,
+        Oscillator::maxUnison, 1));
+    params.push_back(std::make_unique<juce::AudioParameterFloat>("OSC2_SPREAD", "Osc 2 Unison Spread",
+        0.0f, 100.0f, 20.0f));
+    params.push_back(std::make_unique<juce::AudioParameterFloat>("OSC2_WIDTH", "Osc 2 Unison Width",
+        0.0f, 1.0f, 1.0f));
+    params.push_back(std::make_unique<juce::AudioParameterChoice>("OSC2_MODE", "Osc 2 Anti-aliasing",
+        juce::StringArray({ "Wavetable", "PolyBLEP" }), 0));
+
+    //Osc 2 modulating osc 1
+    params.push_back(std::make_unique<juce::AudioParameterChoice>("OSC_MOD", "Osc Cross Modulation",
+        juce::StringArray({ "Off", "FM", "Ring", "Hard Sync" }), 0));
+    params.push_back(std::make_unique<juce::AudioParameterFloat>("OSC_FM_AMOUNT", "Osc FM Amount",
+        juce::NormalisableRange<float>(0.0f, 10.0f, 0.f, 0.5), 1.0f));
 
 
     //Vol env
@@ -344,10 +480,18 @@ juce::AudioProcessorValueTreeState::ParameterLayout NEASynthesiserAudioProcessor
         0.0f, 1.0f, 1.0f));
     params.push_back(std::make_unique<juce::AudioParameterFloat>("VOL_ENV_RELEASE", "Volume Envelope Release", 
         juce::NormalisableRange<float>(0.0f, 5000.0f, 0.f, 0.4), 0.0f));
+    params.push_back(std::make_unique<juce::AudioParameterFloat>("VOL_ENV_ATTACK_CURVE", "Volume Envelope Attack Curve",
+        -1.0f, 1.0f, 0.0f));
+    params.push_back(std::make_unique<juce::AudioParameterFloat>("VOL_ENV_DECAY_CURVE", "Volume Envelope Decay Curve",
+        -1.0f, 1.0f, 0.0f));
+    params.push_back(std::make_unique<juce::AudioParameterFloat>("VOL_ENV_RELEASE_CURVE",
+        "Volume Envelope Release Curve", -1.0f, 1.0f, 0.0f));
 
     //Filter
     params.push_back(std::make_unique< juce::AudioParameterChoice>("FILTER_TYPE", "Filter Type",
-        juce::StringArray({ "Low-pass", "High-pass" }), 0));
+        juce::StringArray({ "Low-pass", "High-pass", "Band-pass", "Notch" }), 0));
+    params.push_back(std::make_unique<juce::AudioParameterChoice>("FILTER_MODE", "Filter Mode",
+        juce::StringArray({ "Biquad", "State Variable" }), 0));
     params.push_back(std::make_unique<juce::AudioParameterFloat>("FILTER_CF", "Filter Cutoff Frequency",
         juce::NormalisableRange<float>(40.0f, 20000.0f, 0.f, 0.23), 20000.0f));
     params.push_back(std::make_unique<juce::AudioParameterFloat>("FILTER_RES", "Filter Resonance",
@@ -363,6 +507,12 @@ juce::AudioProcessorValueTreeState::ParameterLayout NEASynthesiserAudioProcessor
         0.0f, 1.0f, 1.0f));
     params.push_back(std::make_unique<juce::AudioParameterFloat>("FILTER_ENV_RELEASE", "Filter Envelope Release", 
         juce::NormalisableRange<float>(20.0f, 5000.0f, 0.f, 0.4), 20.0f));
+    params.push_back(std::make_unique<juce::AudioParameterFloat>("FILTER_ENV_ATTACK_CURVE",
+        "Filter Envelope Attack Curve", -1.0f, 1.0f, 0.0f));
+    params.push_back(std::make_unique<juce::AudioParameterFloat>("FILTER_ENV_DECAY_CURVE",
+        "Filter Envelope Decay Curve", -1.0f, 1.0f, 0.0f));
+    params.push_back(std::make_unique<juce::AudioParameterFloat>("FILTER_ENV_RELEASE_CURVE",
+        "Filter Envelope Release Curve", -1.0f, 1.0f, 0.0f));
 
     //LFO
     params.push_back(std::make_unique< juce::AudioParameterChoice>("LFO_DEST", "LFO Destination",
@@ -372,6 +522,19 @@ juce::AudioProcessorValueTreeState::ParameterLayout NEASynthesiserAudioProcessor
     params.push_back(std::make_unique<juce::AudioParameterFloat>("LFO_RATE", "LFO Rate", 
         juce::NormalisableRange<float>(0.0f, 20.0f, 0.f, 0.6), 0.0f));
 
+    //Voices
+    params.push_back(std::make_unique<juce::AudioParameterInt>("POLYPHONY", "Polyphony", 1,
+        SynthVoiceArray::maxPolyphony, 32));
+    params.push_back(std::make_unique<juce::AudioParameterChoice>("VOICE_STEALING", "Voice Stealing",
+        juce::StringArray({ "Release First", "Oldest", "Quietest", "Same Note" }), 3));
+    params.push_back(std::make_unique<juce::AudioParameterBool>("MULTITHREADING", "Multithreaded Rendering", false));
+    params.push_back(std::make_unique<juce::AudioParameterChoice>("CONTROL_INTERVAL", "Modulation Interval",
+        juce::StringArray({ "8 Samples", "16 Samples", "32 Samples", "64 Samples" }), 2));
+    params.push_back(std::make_unique<juce::AudioParameterChoice>("QUALITY", "Quality",
+        juce::StringArray({ "Eco", "Normal", "High" }), 1));
+    params.push_back(std::make_unique<juce::AudioParameterFloat>("SILENCE_THRESHOLD", "Silence Threshold",
+        -140.0f, -60.0f, -100.0f));
+
 
 
     return { params.begin(), params.end() };
@@ -15,11 +15,16 @@
 #include "Envelope.h"
 #include "Filter.h"
 #include "LFO.h"
+#include "Wavetables.h"
+#include "FilterTable.h"
+#include "Downsampler.h"
 
 //==============================================================================
 /**
 */
-class NEASynthesiserAudioProcessor  : public juce::AudioProcessor
+class NEASynthesiserAudioProcessor  : public juce::AudioProcessor,
+                                      private juce::AudioProcessorValueTreeState::Listener,
+                                      private juce::AsyncUpdater
                             #if JucePlugin_Enable_ARA
                              , public juce::AudioProcessorARAExtension
                             #endif
@@ -62,7 +67,19 @@ public:
     void getStateInformation (juce::MemoryBlock& destData) override;
     void setStateInformation (const void* data, int sizeInBytes) override;
 
-    double sampleRate;
+    //how much work goes into every voice. ECO works the square and saw out without any anti-aliasing and the
+    //modulation out a quarter as often. HIGH renders the voices at twice the sample rate and filters them back
+    //down, which takes the aliasing that is left down much further and halves the time between control points
+    enum Quality {
+        ECO, NORMAL, HIGH
+    };
+
+    static constexpr int maxOversampling = 2;
+
+    double sampleRate;          //the rate the voices are rendered at, which is hostSampleRate times oversampling
+    double hostSampleRate;
+    enum Quality quality;
+    int oversampling;
 
     Oscillator osc1;
     Oscillator osc2;
@@ -70,14 +87,37 @@ public:
     Envelope volumeEnv;
     FrequencyFilter filter;
     LFO lfo;
+    Wavetables wavetables;
+    FilterTable filterTable;
+    FilterTable oversampledFilterTable;     //the same at twice the sample rate, for HIGH quality
 
     juce::AudioProcessorValueTreeState apvts;
     
     NEASynthesiserAudioProcessorEditor* editor;
 
+    //the filter table for the rate the voices are rendered at
+    const FilterTable& getFilterTable() const;
+
 private:
+    //with oversampling the voices are rendered into oversampledBuffer, which the downsampler then filters down
+    //into the host's buffer
+    juce::AudioBuffer<float> oversampledBuffer;
+    Downsampler downsampler;
+
     //==============================================================================
     juce::AudioProcessorValueTreeState::ParameterLayout createParameters();
 
+    //applies a note on or note off message to the voices
+    void handleNoteMessage(const juce::MidiMessage& msg);
+
+    //renders the voices into numSamples samples of the buffer, starting at startSample
+    void renderVoices(juce::AudioBuffer<float>& buffer, int startSample, int numSamples);
+
+    //the render threads are started and stopped on the message thread, since that can't happen on the audio thread.
+    //A change to Multithreaded Rendering can come from any thread, so it is passed on with an async update
+    void parameterChanged(const juce::String& parameterID, float newValue) override;
+    void handleAsyncUpdate() override;
+    bool isMultithreadingOn() const;
+
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (NEASynthesiserAudioProcessor)
 };
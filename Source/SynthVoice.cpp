@@ -11,302 +11,1493 @@
 #include "SynthVoice.h"
 #include "PluginProcessor.h"
 
-// SynthVoice============================================================================================================
+using SIMDFloat = SynthVoiceArray::SIMDFloat;
+using SIMDPhase = SynthVoiceArray::SIMDPhase;
+using Phase = Oscillator::Phase;
 
-SynthVoice::SynthVoice(NEASynthesiserAudioProcessor& p) : parentProcessor(p),
-lastTwoInputSamples(2, { 0.0f, 0.0f }), lastTwoOutputSamples(2, { 0.0f, 0.0f })
-{
-    currentSampleIndex = 0;
-    startSampleIndex = 0;
-    currentOsc1Angle = 0.0f;
-    currentOsc2Angle = 0.0f;
-    currentOsc1LFOAngle = 0.0f;
-    currentOsc2LFOAngle = 0.0f;
-    _midiNote = 0;
-    midiVelocity = 0.0f;
-    isNoteOn = false;
-    _isFree = true;
+//the difference between two phase deltas over a number of samples, as a step that can be added on every sample
+static inline Phase getPhaseDeltaStep(Phase from, Phase to, int numSamples) {
+    auto difference = static_cast<juce::int64>(to) - static_cast<juce::int64>(from);
+
+    return static_cast<Phase>(difference / numSamples);
 }
 
-void SynthVoice::resetVoice(double midiVelocity, int startSampleIndex) {
-    currentSampleIndex = 0;
-    currentOsc1Angle = 0.0f;
-    currentOsc2Angle = 0.0f;
-    currentOsc1LFOAngle = 0.0f;
-    currentOsc2LFOAngle = 0.0f;
-    isNoteOn = true;
-    _isFree = false;
+//the phase delta and step of each of the first numCopies unison copies, which are the note's own times the copy's
+//pitch ratio. Each copy's is written stride places after the last one. Detuning a note that is just under the
+//sample rate upwards folds it back down, the same as Oscillator::getPhaseDelta() does
+static inline void getCopyPhaseDeltas(const Oscillator::UnisonStack& stack, Phase delta, Phase deltaStep,
+    int numCopies, Phase* copyDeltas, Phase* copyDeltaSteps, int stride) {
+    auto signedDeltaStep = static_cast<double>(static_cast<juce::int32>(deltaStep));
+
+    for (int copy = 0; copy < numCopies; ++copy) {
+        double ratio = stack.pitchRatio[copy];
 
-    this->midiVelocity = midiVelocity;
-    this->startSampleIndex = startSampleIndex;
+        copyDeltas[copy * stride] = Oscillator::cyclesToPhase(ratio * delta / Oscillator::phasesPerCycle);
+        copyDeltaSteps[copy * stride] =
+            static_cast<Phase>(static_cast<juce::int64>(std::round(ratio * signedDeltaStep)));
+    }
 }
 
-void SynthVoice::addVoice(int midiNote, double midiVelocity, int startSampleIndex) {
-    //this is identical to resetVoice except that it also resets the midiNote. This function is only called in the
-    //addVoice() method of the SynthVoiceArray class
+// SynthVoiceArray===========================================================================================================
+
+
+SynthVoiceArray::SynthVoiceArray(NEASynthesiserAudioProcessor& p) : parentProcessor(p) {
+    polyphony = 32;
+    stealingPolicy = SAME_NOTE;
+    isMultithreaded = false;
+    isPrepared = false;
+    silenceThreshold = 0.00001f;       //-100dB
+    crossModulation = NONE;
+    fmAmount = 1.0;
+    controlInterval = 32;
+    groupKernel = &SynthVoiceArray::generateGroupAudio<true, true, NONE, false>;
+    osc1Mix = { 1.0f, 1.0f, false };
+    osc2Mix = { 1.0f, 1.0f, false };
+    monoChannel = 0;
+    monoOtherGain = 1.0f;
+    osc1Stack.numCopies = 1;
+    osc2Stack.numCopies = 1;
+    isCrossModulated = false;
+
+    filterType = FrequencyFilter::LOWPASS;
+    isStateVariable = false;
+    filterResonance = 0.0;
+    filterLFOAmount = 0.0;
+    filterSampleRate = 0.0;
+
+    for (auto& target : filterTarget) {
+        target.isValid = false;
+    }
+
+    scratchSize = 0;
+    currentBlockSize = 0;
+    samplesUntilControlPoint = 0;
+
+    noteCounter = 0;
+    numSoundingVoices = 0;
+    numActiveVoices = 0;
+    numPlayingGroups = 0;
 
-    resetVoice(midiVelocity, startSampleIndex);
-    this->_midiNote = midiNote;
+    for (auto& count : numActiveVoicesInGroup) {
+        count = 0;
+    }
+
+    for (auto& voice : voiceForNote) {
+        voice = -1;
+    }
+
+    for (auto& lanes : filterLanes) {
+        lanes.reset();
+    }
+
+    for (int group = 0; group < numGroups; ++group) {
+        volumeEnvelope.lanes[group].reset();
+        filterEnvelope.lanes[group].reset();
+    }
+
+    //the voices are pushed in reverse so that the lowest ones get used first. Freed voices are reused first as
+    //well, which keeps the playing voices packed into as few SIMD groups as possible
+    numFreeVoices = 0;
+
+    for (int i = maxNumVoices - 1; i >= 0; --i) {
+        activeVoiceSlot[i] = -1;
+        clearVoice(i);
+        silenceVoice(i);
+        freeVoices[numFreeVoices++] = i;
+    }
 }
 
-void SynthVoice::turnOffVoice(int startSampleIndex) {
-    currentSampleIndex = 0;
-    isNoteOn = false;
-    this->startSampleIndex = startSampleIndex;
+void SynthVoiceArray::startNote(int midiNote, double midiVelocity) {
+    int previousVoice = voiceForNote[midiNote];
+
+    if (previousVoice != -1) {
+        if (stealingPolicy == SAME_NOTE) {
+            stealVoice(previousVoice);
+        }
+        else if (isNoteOn[previousVoice]) {
+            //the old voice is left to ring out on its own, and the note is given a new voice below
+            turnOffVoice(previousVoice);
+        }
+    }
+
+    //if every voice that the polyphony allows is in use then one of them has to make way. This is a loop in case the
+    //polyphony has just been turned down
+    while (numSoundingVoices >= polyphony) {
+        stealVoice(chooseVoiceToSteal());
+    }
+
+    int index = allocateVoice();
+    resetVoice(index, midiNote, midiVelocity);
+    voiceForNote[midiNote] = index;
 }
 
-const int& SynthVoice::midiNote() const {
-    return _midiNote;
+void SynthVoiceArray::stopNote(int midiNote) {
+    int index = voiceForNote[midiNote];
+
+    //if the note is not playing, or has already been released, then do nothing
+    if (index != -1 && isNoteOn[index]) {
+        turnOffVoice(index);
+    }
 }
 
-const bool& SynthVoice::isFree() const {
-    return _isFree;
+int SynthVoiceArray::allocateVoice() {
+    //there are more voices than the polyphony allows for, and the extra ones are only ever taken up by stolen voices
+    //fading out. If so many voices were stolen at once that none are left, the one closest to silence is cut off
+    if (numFreeVoices == 0) {
+        int quickestFade = -1;
+
+        for (int slot = 0; slot < numActiveVoices; ++slot) {
+            int i = activeVoices[slot];
+
+            if (isStolen[i] && (quickestFade == -1 || fadeSamplesLeft[i] < fadeSamplesLeft[quickestFade])) {
+                quickestFade = i;
+            }
+        }
+
+        freeVoice(quickestFade);
+    }
+
+    int index = freeVoices[--numFreeVoices];
+    ++numSoundingVoices;
+    activateVoice(index);
+
+    return index;
 }
 
-double SynthVoice::getCurrentVolume()
-{
-    if (!isNoteOn)      //if isNoteOn == False
-    {    
-        if (currentSampleIndex < parentProcessor.volumeEnv.release) 
-        {
-            //use releaseVolume instead of the sustain volume for the computation here
-            tailVolume = releaseVolume - (static_cast<double>(currentSampleIndex) *
-                releaseVolume / static_cast<double>(parentProcessor.volumeEnv.release));
+void SynthVoiceArray::activateVoice(int index) {
+    activeVoiceSlot[index] = numActiveVoices;
+    activeVoices[numActiveVoices++] = index;
+
+    //the first voice in a group puts the group into the list, in the right place to keep the list in order
+    int group = index / simdWidth;
 
-            return tailVolume;
-        } 
-        else 
-        {
-            //explicitly not setting tailVolume here, since tailVolume should be the final volume you calculate from 
-            //this function.
+    if (numActiveVoicesInGroup[group]++ == 0) {
+        int slot = numPlayingGroups++;
 
-            return 0;
+        for (; slot > 0 && playingGroups[slot - 1] > group; --slot) {
+            playingGroups[slot] = playingGroups[slot - 1];
         }
+
+        playingGroups[slot] = group;
     }
+}
+
+int SynthVoiceArray::chooseVoiceToSteal() const {
+    //this searches every playing voice, but it only happens when the polyphony has been used up
+    int oldest = -1;
+    int oldestReleased = -1;
+    int quietest = -1;
+    double quietestVolume = 0.0;
+
+    for (int slot = 0; slot < numActiveVoices; ++slot) {
+        int i = activeVoices[slot];
+
+        if (isStolen[i]) {
+            continue;
+        }
+
+        if (oldest == -1 || noteOnTime[i] < noteOnTime[oldest]) {
+            oldest = i;
+        }
+
+        if (!isNoteOn[i] && (oldestReleased == -1 || noteOffTime[i] < noteOffTime[oldestReleased])) {
+            oldestReleased = i;
+        }
+
+        //a voice that hasn't been rendered yet has no volume, so it is judged by how loud it was played instead.
+        //Otherwise the notes of a big chord would just steal each other
+        double currentVolume = (isNoteOn[i] && currentSampleIndex[i] == 0) ? midiVelocity[i] : volume[i];
+
+        //the active voices aren't in any order, so a tie goes to the older voice
+        if (quietest == -1 || currentVolume < quietestVolume ||
+            (currentVolume == quietestVolume && noteOnTime[i] < noteOnTime[quietest])) {
+            quietest = i;
+            quietestVolume = currentVolume;
+        }
+    }
+
+    switch (stealingPolicy) {
+    case OLDEST:
+        return oldest;
+    case QUIETEST:
+        return quietest;
+    default:    //RELEASE_FIRST and SAME_NOTE
+        return oldestReleased != -1 ? oldestReleased : oldest;
+    }
+}
+
+int SynthVoiceArray::getStealFadeLength() const {
+    return juce::jmax(1, static_cast<int>(stealFadeSeconds * parentProcessor.sampleRate));
+}
+
+void SynthVoiceArray::stealVoice(int index) {
+    //a stolen voice ignores its envelope from now on and fades out in a straight line from wherever it is
+    isStolen[index] = true;
+    fadeSamplesLeft[index] = getStealFadeLength();
+    fadeStartVolume[index] = volume[index];
+    setStraightVolumeRamp(index, -fadeStartVolume[index] / static_cast<float>(fadeSamplesLeft[index]));
+
+    //the note no longer belongs to this voice, so a note off for it shouldn't find this voice
+    if (voiceForNote[midiNote[index]] == index) {
+        voiceForNote[midiNote[index]] = -1;
+    }
+
+    --numSoundingVoices;
+}
+
+void SynthVoiceArray::resetVoice(int index, int midiNote, double midiVelocity) {
+    currentSampleIndex[index] = 0;
+    currentLFOPhase[index] = 0;
+    isNoteOn[index] = true;
+    isFree[index] = false;
+    isStolen[index] = false;
+    isFinished[index] = false;
+    outputPeak[index] = 0.0f;
+    noteOnTime[index] = ++noteCounter;
+
+    for (int copy = 0; copy < Oscillator::maxUnison; ++copy) {
+        osc1Voices.phase[copy][index] = Oscillator::getUnisonStartPhase(copy);
+        osc2Voices.phase[copy][index] = Oscillator::getUnisonStartPhase(copy);
+    }
+
+    this->midiNote[index] = midiNote;
+    this->midiVelocity[index] = midiVelocity;
+
+    startVoiceModulation(index);
+}
+
+void SynthVoiceArray::turnOffVoice(int index) {
+    //the release starts from wherever the envelopes are at this exact sample, which is usually between two control
+    //points
+    releaseEnvelope(volumeEnvelope, parentProcessor.volumeEnv, index);
+    releaseEnvelope(filterEnvelope, parentProcessor.filter.env, index);
+
+    currentSampleIndex[index] = 0;
+    isNoteOn[index] = false;
+    needsNewRamp[index] = true;
+    noteOffTime[index] = ++noteCounter;
+}
+
+void SynthVoiceArray::freeVoice(int index) {
+    if (!isStolen[index]) {
+        --numSoundingVoices;
+    }
+
+    if (voiceForNote[midiNote[index]] == index) {
+        voiceForNote[midiNote[index]] = -1;
+    }
+
+    //the last voice in the list takes this voice's place
+    int slot = activeVoiceSlot[index];
+    int lastVoice = activeVoices[--numActiveVoices];
+
+    activeVoices[slot] = lastVoice;
+    activeVoiceSlot[lastVoice] = slot;
+    activeVoiceSlot[index] = -1;
+
+    int group = index / simdWidth;
+
+    if (--numActiveVoicesInGroup[group] == 0) {
+        int groupSlot = 0;
+
+        while (playingGroups[groupSlot] != group) {
+            ++groupSlot;
+        }
+
+        for (; groupSlot < numPlayingGroups - 1; ++groupSlot) {
+            playingGroups[groupSlot] = playingGroups[groupSlot + 1];
+        }
+
+        --numPlayingGroups;
+    }
+
+    clearVoice(index);
+    freeVoices[numFreeVoices++] = index;
+}
+
+void SynthVoiceArray::clearVoice(int index) {
+    currentSampleIndex[index] = 0;
+    currentLFOPhase[index] = 0;
+    midiNote[index] = -1;
+    midiVelocity[index] = 0.0f;
+    isNoteOn[index] = false;
+    isFree[index] = true;
+    isStolen[index] = false;
+    needsNewRamp[index] = false;
+    samplesUntilNewRamp[index] = 0;
+    isFinished[index] = false;
+    outputPeak[index] = 0.0f;
+
+    volumeEnvelope.lanes[index / simdWidth].resetLane(static_cast<size_t>(index % simdWidth));
+    filterEnvelope.lanes[index / simdWidth].resetLane(static_cast<size_t>(index % simdWidth));
+
+    noteOnTime[index] = 0;
+    noteOffTime[index] = 0;
+    fadeSamplesLeft[index] = 0;
+    fadeStartVolume[index] = 0.0f;
+    volume[index] = 0.0f;
+    setStraightVolumeRamp(index, 0.0f);
+    osc1Voices.phaseDeltaStep[index] = 0;
+    osc2Voices.phaseDeltaStep[index] = 0;
+
+    for (int copy = 0; copy < Oscillator::maxUnison; ++copy) {
+        osc1Voices.phase[copy][index] = 0;
+        osc2Voices.phase[copy][index] = 0;
+        osc1Voices.copyPhaseDelta[copy][index] = 0;
+        osc2Voices.copyPhaseDelta[copy][index] = 0;
+        osc1Voices.copyPhaseDeltaStep[copy][index] = 0;
+        osc2Voices.copyPhaseDeltaStep[copy][index] = 0;
+    }
+
+    filterLanes[index / simdWidth].resetLane(static_cast<size_t>(index % simdWidth));
+}
+
+double SynthVoiceArray::getEnvelopeLevel(const EnvelopeVoices& envelope, const Envelope& settings,
+    int index) const {
+    float releaseLevel = envelope.lanes[index / simdWidth].releaseLevel.get(static_cast<size_t>(index % simdWidth));
 
-    if (currentSampleIndex < parentProcessor.volumeEnv.attack)
-    {
-        if (parentProcessor.volumeEnv.decay == 0)
-        {
-            releaseVolume = currentSampleIndex * static_cast<double>(parentProcessor.volumeEnv.sustain)
-                / static_cast<double>(parentProcessor.volumeEnv.attack);
+    return settings.getLevel(currentSampleIndex[index], isNoteOn[index], releaseLevel);
+}
+
+void SynthVoiceArray::releaseEnvelope(EnvelopeVoices& envelope, const Envelope& settings, int index) {
+    float level = static_cast<float>(getEnvelopeLevel(envelope, settings, index));
+
+    envelope.lanes[index / simdWidth].releaseLevel.set(static_cast<size_t>(index % simdWidth), level);
+}
+
+void SynthVoiceArray::setUpEnvelopeRamps(EnvelopeVoices& envelope, const Envelope& settings, int group,
+    int rampLength, bool isControlPoint) {
+    auto& lanes = envelope.lanes[group];
+    int firstVoice = group * simdWidth;
+
+    auto sampleIndex = SIMDFloat::expand(0.0f);
+    auto isNoteOnMask = SIMDFloat::vMaskType::expand(0);
+    auto isMoving = SIMDFloat::vMaskType::expand(0);
 
-            tailVolume = releaseVolume;
+    for (int i = firstVoice; i < firstVoice + simdWidth; ++i) {
+        auto lane = static_cast<size_t>(i - firstVoice);
 
-            return tailVolume;
+        if (isFree[i] || isFinished[i] || !(isControlPoint || needsNewRamp[i])) {
+            continue;
+        }
+
+        //a voice that has just started or been released, or that has to change course in between two control
+        //points, picks its envelope up from exactly where it is. Otherwise it carries on from the last one
+        if (needsNewRamp[i]) {
+            lanes.level.set(lane, static_cast<float>(getEnvelopeLevel(envelope, settings, i)));
         }
 
-        releaseVolume = currentSampleIndex / static_cast<double>(parentProcessor.volumeEnv.attack);
+        sampleIndex.set(lane, static_cast<float>(currentSampleIndex[i]));
+        isNoteOnMask.set(lane, isNoteOn[i] ? ~0u : 0u);
+        isMoving.set(lane, ~0u);
+    }
+
+    if (isMoving != 0u) {
+        lanes.setUpRamps(settings, envelope.steps, sampleIndex, isNoteOnMask, isMoving, rampLength);
+    }
+}
+
+void SynthVoiceArray::setStraightVolumeRamp(int index, float delta) {
+    volumeMultiplier[index] = 1.0f;
+    volumeDelta[index] = delta;
+    volumeBreakMultiplier[index] = 1.0f;
+    volumeBreakDelta[index] = delta;
+    samplesUntilVolumeBreak[index] = 0.0f;
+}
+
+void SynthVoiceArray::startVoiceModulation(int index) {
+    auto& filter = parentProcessor.filter;
+
+    osc1Voices.phaseDelta[index] = parentProcessor.osc1.getPhaseDelta(midiNote[index], currentLFOPhase[index]);
+    osc2Voices.phaseDelta[index] = parentProcessor.osc2.getPhaseDelta(midiNote[index], currentLFOPhase[index]);
+    osc1Voices.phaseDeltaStep[index] = 0;
+    osc2Voices.phaseDeltaStep[index] = 0;
+
+    volume[index] = static_cast<float>(midiVelocity[index] * parentProcessor.volumeEnv.getLevel(0, true, 0.0));
+    setStraightVolumeRamp(index, 0.0f);
+
+    double frequency = filter.getCentreFrequency(filter.env.getLevel(0, true, 0.0));
+    setFilterCoefficients(index, frequency, filter.currentLFOPhase);
+
+    //the voice is heading nowhere yet, so it has to be pointed at the next control point before it renders
+    needsNewRamp[index] = true;
+}
+
+void SynthVoiceArray::setUpVoiceRamp(int index, int rampLength, Phase filterLFOPhase) {
+    auto& osc1 = parentProcessor.osc1;
+    auto& osc2 = parentProcessor.osc2;
+    auto& filter = parentProcessor.filter;
+    auto& lfo = parentProcessor.lfo;
+
+    auto ramp = static_cast<float>(rampLength);
 
-        tailVolume = releaseVolume;
-        
-        return tailVolume;
+    //the pitch LFO phase that the voice will be at by the end of the ramp
+    Phase lfoPhase = currentLFOPhase[index];
+
+    if (lfo.destination == lfo.PITCH) {
+        lfoPhase += lfo.phaseDelta * static_cast<Phase>(rampLength);
+    }
+
+    setUpOscillatorRamp(osc1Voices, osc1Stack, index, osc1.getPhaseDelta(midiNote[index], lfoPhase), rampLength);
+    setUpOscillatorRamp(osc2Voices, osc2Stack, index, osc2.getPhaseDelta(midiNote[index], lfoPhase), rampLength);
+
+    samplesUntilNewRamp[index] = rampLength;
+
+    //a stolen voice keeps fading out at the rate stealVoice() set instead
+    if (!isStolen[index]) {
+        auto& envelope = volumeEnvelope.lanes[index / simdWidth];
+        auto lane = static_cast<size_t>(index % simdWidth);
+        auto& steps = volumeEnvelope.steps;
+        auto before = envelope.getStage(lane);
+        auto after = envelope.getBreakStage(lane);
+        auto samplesUntilBreak = static_cast<int>(envelope.samplesUntilBreak.get(lane));
+        auto samplesUntilRampEnd = static_cast<int>(envelope.samplesUntilRampEnd.get(lane));
+        double breakVolume = midiVelocity[index] * envelope.breakLevel.get(lane);
+
+        //the steps are worked out from where the volume really is, so that it lands on the envelope at the control
+        //point. When a stage of the envelope ends before the control point, the volume heads for the exact corner
+        //first and turns there, so the attack peaks and the release ends on the right sample whatever the interval.
+        //If the stage after that ends before the control point as well, the ramp stops at its end and the voice
+        //sets up a new one from there, so that every corner lands on its sample
+        volumeMultiplier[index] = steps.stages[before].multiplier;
+        volumeDelta[index] = static_cast<float>(steps.getStep(before, volume[index], breakVolume,
+            samplesUntilBreak));
+
+        if (samplesUntilBreak < samplesUntilRampEnd) {
+            double targetVolume = midiVelocity[index] * envelope.targetLevel.get(lane);
+
+            volumeBreakMultiplier[index] = steps.stages[after].multiplier;
+            volumeBreakDelta[index] = static_cast<float>(steps.getStep(after, breakVolume, targetVolume,
+                samplesUntilRampEnd - samplesUntilBreak));
+            samplesUntilVolumeBreak[index] = static_cast<float>(samplesUntilBreak);
+        }
+        else {
+            volumeBreakMultiplier[index] = volumeMultiplier[index];
+            volumeBreakDelta[index] = volumeDelta[index];
+            samplesUntilVolumeBreak[index] = 0.0f;
+        }
+
+        samplesUntilNewRamp[index] = samplesUntilRampEnd;
     }
-    else if (currentSampleIndex - parentProcessor.volumeEnv.attack < parentProcessor.volumeEnv.decay)
-    {
-        int shiftedCurrentSampleIndex = currentSampleIndex - parentProcessor.volumeEnv.attack;
 
-        releaseVolume = 1 + (shiftedCurrentSampleIndex * ((parentProcessor.volumeEnv.sustain - 1) /
-            static_cast<double>(parentProcessor.volumeEnv.decay)));
+    double frequency = filter.getCentreFrequency(
+        filterEnvelope.lanes[index / simdWidth].targetLevel.get(static_cast<size_t>(index % simdWidth)));
+
+    auto& target = getFilterTarget(index, frequency, filterLFOPhase);
+
+    //every set of coefficients in between two stable ones is stable as well, so the filter can't blow up on the way
+    auto& lanes = filterLanes[index / simdWidth];
+    auto lane = static_cast<size_t>(index % simdWidth);
+
+    lanes.c1Step.set(lane, (target.c1 - lanes.c1.get(lane)) / ramp);
+    lanes.c2Step.set(lane, (target.c2 - lanes.c2.get(lane)) / ramp);
+    lanes.c3Step.set(lane, (target.c3 - lanes.c3.get(lane)) / ramp);
+    lanes.c4Step.set(lane, (target.c4 - lanes.c4.get(lane)) / ramp);
+
+    needsNewRamp[index] = false;
+}
+
+void SynthVoiceArray::setUpOscillatorRamp(OscillatorVoices& voices, const Oscillator::UnisonStack& stack, int index,
+    Phase targetPhaseDelta, int rampLength) {
+    Phase phaseDelta = voices.phaseDelta[index];
+    Phase phaseDeltaStep = getPhaseDeltaStep(phaseDelta, targetPhaseDelta, rampLength);
 
-        tailVolume = releaseVolume;
+    voices.phaseDeltaStep[index] = phaseDeltaStep;
 
-        return tailVolume;
+    //the table has to be band-limited enough for whichever end of the ramp is higher
+    voices.tablePhaseDelta[index] = juce::jmax(phaseDelta, targetPhaseDelta);
+
+    if (stack.numCopies > 1) {
+        getCopyPhaseDeltas(stack, phaseDelta, phaseDeltaStep, stack.numCopies, &voices.copyPhaseDelta[0][index],
+            &voices.copyPhaseDeltaStep[0][index], maxNumVoices);
     }
-    else
-    {
-        releaseVolume = parentProcessor.volumeEnv.sustain;
-        tailVolume = releaseVolume;
-        return tailVolume;
+}
+
+const SynthVoiceArray::FilterTarget& SynthVoiceArray::getFilterTarget(int index, double frequency,
+    Phase filterLFOPhase) {
+    auto& lfo = parentProcessor.lfo;
+    auto& target = filterTarget[index];
+
+    //the LFO phase only makes a difference when the LFO is on the filter
+    Phase lfoPhase = lfo.destination == lfo.FILTER ? filterLFOPhase : 0;
+
+    if (!target.isValid || target.frequency != frequency || target.lfoPhase != lfoPhase) {
+        parentProcessor.filter.getCoefficients(frequency, lfoPhase, target.c1, target.c2, target.c3, target.c4);
+
+        target.frequency = frequency;
+        target.lfoPhase = lfoPhase;
+        target.isValid = true;
     }
+
+    return target;
 }
 
+void SynthVoiceArray::setFilterCoefficients(int index, double frequency, Phase filterLFOPhase) {
+    auto& target = getFilterTarget(index, frequency, filterLFOPhase);
 
+    auto& lanes = filterLanes[index / simdWidth];
+    auto lane = static_cast<size_t>(index % simdWidth);
 
-std::vector<std::vector<float>> SynthVoice::generateAudio(int blockSize) {
+    lanes.c1.set(lane, target.c1);
+    lanes.c2.set(lane, target.c2);
+    lanes.c3.set(lane, target.c3);
+    lanes.c4.set(lane, target.c4);
+    lanes.c1Step.set(lane, 0.0f);
+    lanes.c2Step.set(lane, 0.0f);
+    lanes.c3Step.set(lane, 0.0f);
+    lanes.c4Step.set(lane, 0.0f);
+}
 
-    //the 0th index of each list contains the left channel and the 1st index contains the right channel
-    auto tempStartSampleIndex = startSampleIndex;
-    
-    auto osc1Audio = parentProcessor.osc1.generateAudio(blockSize, _midiNote, startSampleIndex,
-        currentOsc1Angle, currentOsc1LFOAngle, isNoteOn);
+void SynthVoiceArray::silenceVoice(int index) {
+    //a free voice shares its group with voices that are playing, so its lane still gets computed. Zeroing all of
+    //this makes sure the lane outputs nothing and its phases stay put
+    osc1Voices.phaseDelta[index] = 0;
+    osc2Voices.phaseDelta[index] = 0;
+    osc1Voices.phaseDeltaStep[index] = 0;
+    osc2Voices.phaseDeltaStep[index] = 0;
+    osc1Voices.tablePhaseDelta[index] = 0;
+    osc2Voices.tablePhaseDelta[index] = 0;
+    volume[index] = 0.0f;
+    setStraightVolumeRamp(index, 0.0f);
+
+    auto& lanes = filterLanes[index / simdWidth];
+    auto lane = static_cast<size_t>(index % simdWidth);
+
+    lanes.c1.set(lane, 0.0f);
+    lanes.c2.set(lane, 0.0f);
+    lanes.c3.set(lane, 0.0f);
+    lanes.c4.set(lane, 0.0f);
+    lanes.c1Step.set(lane, 0.0f);
+    lanes.c2Step.set(lane, 0.0f);
+    lanes.c3Step.set(lane, 0.0f);
+    lanes.c4Step.set(lane, 0.0f);
+
+    //the state variable filter keeps putting out what is left in its state even with all its coefficients at zero
+    lanes.resetLane(lane);
+}
 
-    auto osc2Audio = parentProcessor.osc2.generateAudio(blockSize, _midiNote, tempStartSampleIndex,
-        currentOsc2Angle, currentOsc2LFOAngle, isNoteOn);
+void SynthVoiceArray::advanceVoice(int index, int numSamples, bool isControlPoint) {
+    auto& lfo = parentProcessor.lfo;
 
-    std::vector<float> leftChannelOutput(blockSize, 0.0f);
-    std::vector<float> rightChannelOutput(blockSize, 0.0f);
+    currentSampleIndex[index] += numSamples;
+    samplesUntilNewRamp[index] -= numSamples;
 
-    auto adsrVol = getCurrentVolume();
-    
-    auto volume = midiVelocity * adsrVol;
+    //a ramp that stopped short of the control point is picked up again from exactly where it stopped
+    if (!isControlPoint && samplesUntilNewRamp[index] <= 0) {
+        needsNewRamp[index] = true;
+    }
 
-    if (currentSampleIndex == 0 && isNoteOn && blockSize > 1) {
+    if (lfo.destination == lfo.PITCH) {
+        currentLFOPhase[index] += lfo.phaseDelta * static_cast<Phase>(numSamples);
+    }
+
+    //the ramps were pointed at where the envelopes would be by now
+    if (isControlPoint) {
+        auto lane = static_cast<size_t>(index % simdWidth);
+
+        for (auto* envelope : { &volumeEnvelope, &filterEnvelope }) {
+            auto& lanes = envelope->lanes[index / simdWidth];
+            lanes.level.set(lane, lanes.targetLevel.get(lane));
+        }
+    }
+
+    if (isStolen[index]) {
+        fadeSamplesLeft[index] -= numSamples;
+        isFinished[index] = fadeSamplesLeft[index] <= 0;
+    }
+    else if (isControlPoint) {
+        //a released voice's envelope only goes down, so once both it and everything the voice put out since the
+        //last control point are below the threshold, nothing more of it will be heard. Until then the voice keeps
+        //going after its envelope reaches zero, so that the filter can ring out. This is only checked at the
+        //control points so that it doesn't depend on how the block is split up
+        isFinished[index] = !isNoteOn[index] && volume[index] <= silenceThreshold &&
+            outputPeak[index] <= silenceThreshold;
+        outputPeak[index] = 0.0f;
+    }
+
+    //the voice can only be freed once the whole block is done, so until then it is kept quiet
+    if (isFinished[index]) {
+        silenceVoice(index);
+    }
+}
+
+void SynthVoiceArray::removeClicksAtNoteStart(int index, int blockSize, RenderScratch& threadScratch,
+    bool isOsc1Audible, bool isOsc2Audible) {
+    //the goal here is to remove all samples before the first zero, so there isnt
+    //any popping sound when the note is switched on. This is done separately for each oscillator, and the zero is
+    //looked for in both channels added together so that they are both cut at the same place. Samples from earlier
+    //blocks have already been sent out, so the zero is only looked for in the part the note starts in, and nothing
+    //is taken out unless one is actually found there
+
+    int lane = index % simdWidth;
+    float* leftScratches[] = { threadScratch.osc1Left, threadScratch.osc2Left };
+    float* rightScratches[] = { osc1Mix.isStereo ? threadScratch.osc1Right : threadScratch.osc1Left,
+        osc2Mix.isStereo ? threadScratch.osc2Right : threadScratch.osc2Left };
+    bool isAudible[] = { isOsc1Audible, isOsc2Audible };
+
+    for (int osc = 0; osc < 2; ++osc) {
+        //an oscillator that can't be heard never gets written into its scratch space
+        if (!isAudible[osc]) {
+            continue;
+        }
+
+        float* leftScratch = leftScratches[osc];
+        float* rightScratch = rightScratches[osc];
         int firstZeroIndex;
         bool zeroEncounteredFlag = false;
 
-        //the goal here is to remove all samples before the first zero, so there isnt 
-        //any popping sound when the note is switched on
-
         //the first for loop finds the index of the first zero value
         for (firstZeroIndex = 1; firstZeroIndex < blockSize; ++firstZeroIndex) {
-            if ((osc1Audio[0][firstZeroIndex] >= 0.0f && osc1Audio[0][firstZeroIndex - 1] <= 0.0f)
-                || (osc1Audio[0][firstZeroIndex] <= 0.0f && osc1Audio[0][firstZeroIndex - 1] >= 0.0f)) {
+            int currentIndex = firstZeroIndex * simdWidth + lane;
+            int previousIndex = (firstZeroIndex - 1) * simdWidth + lane;
+            float current = leftScratch[currentIndex] + rightScratch[currentIndex];
+            float previous = leftScratch[previousIndex] + rightScratch[previousIndex];
+
+            if ((current >= 0.0f && previous <= 0.0f) || (current <= 0.0f && previous >= 0.0f)) {
                 zeroEncounteredFlag = true;
                 break;
             }
         }
 
         if (zeroEncounteredFlag) {
-            zeroEncounteredFlag = false;
             //this loop sets everything before the first zero index to zero
             for (int i = 0; i < firstZeroIndex; ++i) {
-                osc1Audio[0][i] = 0.0f;
-                osc1Audio[1][i] = 0.0f;
+                leftScratch[i * simdWidth + lane] = 0.0f;
+                rightScratch[i * simdWidth + lane] = 0.0f;
             }
         }
+    }
+}
 
-        //the same is repeated for osc2Audio
-        for (firstZeroIndex = 1; firstZeroIndex < blockSize; ++firstZeroIndex) {
-            if ((osc2Audio[0][firstZeroIndex] >= 0.0f && osc2Audio[0][firstZeroIndex - 1] <= 0.0f)
-                || (osc2Audio[0][firstZeroIndex] <= 0.0f && osc2Audio[0][firstZeroIndex - 1] >= 0.0f)) {
-                zeroEncounteredFlag = true;
-                break;
+void SynthVoiceArray::prepare(int samplesPerBlock) {
+    allocateScratch(samplesPerBlock);
+    isPrepared = true;
+}
+
+void SynthVoiceArray::releaseResources() {
+    isPrepared = false;
+    threadPool.stop();
+}
+
+void SynthVoiceArray::setThreadsRunning(bool shouldRun) {
+    if (shouldRun && isPrepared) {
+        threadPool.start(getNumHelperThreads());
+    }
+    else {
+        threadPool.stop();
+    }
+}
+
+int SynthVoiceArray::getNumHelperThreads() {
+    return juce::jlimit(0, maxHelperThreads, juce::SystemStats::getNumCpus() - 1);
+}
+
+void SynthVoiceArray::changeSampleRate(double rateRatio) {
+    auto& filter = parentProcessor.filter;
+
+    for (int slot = 0; slot < numActiveVoices; ++slot) {
+        int index = activeVoices[slot];
+
+        //the counts are in samples, so they stretch or shrink with the rate to keep each voice at the same point
+        //in time. A stolen voice still has the same fade left, just spread over the new number of samples
+        currentSampleIndex[index] = juce::roundToInt(currentSampleIndex[index] * rateRatio);
+
+        if (isStolen[index]) {
+            fadeSamplesLeft[index] = juce::jmax(1, juce::roundToInt(fadeSamplesLeft[index] * rateRatio));
+            setStraightVolumeRamp(index, -volume[index] / static_cast<float>(fadeSamplesLeft[index]));
+        }
+
+        //the pitch is a phase change per sample, so it is worked out again from the note rather than gliding there
+        osc1Voices.phaseDelta[index] = parentProcessor.osc1.getPhaseDelta(midiNote[index], currentLFOPhase[index]);
+        osc2Voices.phaseDelta[index] = parentProcessor.osc2.getPhaseDelta(midiNote[index], currentLFOPhase[index]);
+        osc1Voices.phaseDeltaStep[index] = 0;
+        osc2Voices.phaseDeltaStep[index] = 0;
+
+        //the filter coefficients depend on the rate as well, so the old ones can't be ramped away from
+        double frequency = filter.getCentreFrequency(getEnvelopeLevel(filterEnvelope, filter.env, index));
+
+        filterTarget[index].isValid = false;
+        setFilterCoefficients(index, frequency, filter.currentLFOPhase);
+
+        //the envelopes are picked up again from the rescaled counts
+        needsNewRamp[index] = true;
+    }
+}
+
+void SynthVoiceArray::allocateScratch(int samplesPerBlock) {
+    //the threads can be started after this, so there is scratch space for all of them whether they are running or
+    //not
+    scratch.resize(static_cast<size_t>(getNumHelperThreads() + 1));
+
+    //every buffer is a whole number of SIMDRegisters long, so if the first one is aligned then they all are. One
+    //extra register's worth is allocated so that the start can be aligned
+    int laneBufferSize = samplesPerBlock * simdWidth;
+    int unisonBufferSize = samplesPerBlock * Oscillator::maxUnison;
+
+    for (auto& threadScratch : scratch) {
+        threadScratch.memory.assign(static_cast<size_t>(4 * laneBufferSize + unisonBufferSize + simdWidth), 0.0f);
+        threadScratch.phaseMemory.assign(static_cast<size_t>(unisonBufferSize + simdWidth), 0);
+
+        threadScratch.osc1Left = SIMDFloat::getNextSIMDAlignedPtr(threadScratch.memory.data());
+        threadScratch.osc1Right = threadScratch.osc1Left + laneBufferSize;
+        threadScratch.osc2Left = threadScratch.osc1Right + laneBufferSize;
+        threadScratch.osc2Right = threadScratch.osc2Left + laneBufferSize;
+        threadScratch.unison = threadScratch.osc2Right + laneBufferSize;
+        threadScratch.phases = SIMDPhase::getNextSIMDAlignedPtr(threadScratch.phaseMemory.data());
+    }
+
+    groupOutputMemory.assign(static_cast<size_t>(numGroups * 2 * samplesPerBlock), 0.0f);
+    scratchSize = samplesPerBlock;
+}
+
+void SynthVoiceArray::checkFilterSettings() {
+    auto& filter = parentProcessor.filter;
+    auto& lfo = parentProcessor.lfo;
+    double lfoAmount = lfo.destination == lfo.FILTER ? lfo.amount : 1.0;
+
+    bool wasStateVariable = isStateVariable;
+
+    if (filter.type != filterType || filter.isStateVariable() != isStateVariable ||
+        filter.resonance != filterResonance || lfoAmount != filterLFOAmount ||
+        parentProcessor.sampleRate != filterSampleRate) {
+        filterType = filter.type;
+        isStateVariable = filter.isStateVariable();
+        filterResonance = filter.resonance;
+        filterLFOAmount = lfoAmount;
+        filterSampleRate = parentProcessor.sampleRate;
+
+        for (auto& target : filterTarget) {
+            target.isValid = false;
+        }
+    }
+
+    //the two filters keep their state and coefficients differently, so ramping from one to the other would mean
+    //nothing. Every playing voice starts the new filter from silence at its current coefficients instead
+    if (isStateVariable != wasStateVariable) {
+        for (int slot = 0; slot < numActiveVoices; ++slot) {
+            int index = activeVoices[slot];
+            double frequency = filter.getCentreFrequency(getEnvelopeLevel(filterEnvelope, filter.env, index));
+
+            filterLanes[index / simdWidth].resetLane(static_cast<size_t>(index % simdWidth));
+            setFilterCoefficients(index, frequency, filter.currentLFOPhase);
+            needsNewRamp[index] = true;
+        }
+    }
+}
+
+bool SynthVoiceArray::setUpMix() {
+    auto& osc1 = parentProcessor.osc1;
+    auto& osc2 = parentProcessor.osc2;
+
+    //a unison stack pans every copy differently, so it is already panned by the time it gets mixed
+    osc1Mix.isStereo = !isCrossModulated && osc1Stack.numCopies > 1;
+    osc2Mix.isStereo = !isCrossModulated && osc2Stack.numCopies > 1;
+
+    if (osc1Mix.isStereo) {
+        osc1Mix.leftGain = 1.0f;
+        osc1Mix.rightGain = 1.0f;
+    }
+    else {
+        osc1.getChannelVolumes(osc1Mix.leftGain, osc1Mix.rightGain);
+    }
+
+    if (osc2Mix.isStereo) {
+        osc2Mix.leftGain = 1.0f;
+        osc2Mix.rightGain = 1.0f;
+    }
+    else {
+        osc2.getChannelVolumes(osc2Mix.leftGain, osc2Mix.rightGain);
+    }
+
+    bool isOsc1Audible = osc1.volume > 0.0;
+    bool isOsc2Audible = osc2.volume > 0.0;
+
+    //with nothing playing the filters are only ringing out, and each channel has its own tail to finish
+    if (!isOsc1Audible && !isOsc2Audible) {
+        return false;
+    }
+
+    if ((isOsc1Audible && osc1Mix.isStereo) || (isOsc2Audible && osc2Mix.isStereo)) {
+        return false;
+    }
+
+    if (isOsc1Audible && isOsc2Audible && osc1.pan != osc2.pan) {
+        return false;
+    }
+
+    //panning only ever turns one channel down, so the other is at full volume and is the one that gets filtered
+    double pan = isOsc1Audible ? osc1.pan : osc2.pan;
+
+    monoChannel = pan > 0.0 ? 1 : 0;
+    monoOtherGain = static_cast<float>(1.0 - std::abs(pan));
+
+    return true;
+}
+
+float* SynthVoiceArray::getGroupOutput(int slot, int channel) {
+    return groupOutputMemory.data() + (slot * 2 + channel) * scratchSize;
+}
+
+void SynthVoiceArray::generateAudio(juce::AudioBuffer<float>& outputBuffer, int startSample, int numSamples) {
+    int blockSize = numSamples;
+
+    //the host is allowed to occasionally send a bigger block than it said it would in prepareToPlay(), in which
+    //case the scratch space has to grow. This is the only place the render path can allocate
+    if (blockSize > scratchSize) {
+        allocateScratch(blockSize);
+    }
+
+    //mono layouts only get the left channel
+    float* leftOutput = outputBuffer.getWritePointer(0, startSample);
+    float* rightOutput = outputBuffer.getNumChannels() > 1 ? outputBuffer.getWritePointer(1, startSample) : nullptr;
+
+    int previousOsc1Copies = osc1Stack.numCopies;
+    int previousOsc2Copies = osc2Stack.numCopies;
+
+    parentProcessor.osc1.getUnisonStack(osc1Stack);
+    parentProcessor.osc2.getUnisonStack(osc2Stack);
+
+    //[mono][osc1 audible][osc2 audible]
+    static constexpr GroupKernel groupKernels[2][2][2] = {
+        { { &SynthVoiceArray::generateGroupAudio<false, false, NONE, false>,
+                &SynthVoiceArray::generateGroupAudio<false, true, NONE, false> },
+            { &SynthVoiceArray::generateGroupAudio<true, false, NONE, false>,
+                &SynthVoiceArray::generateGroupAudio<true, true, NONE, false> } },
+        { { &SynthVoiceArray::generateGroupAudio<false, false, NONE, true>,
+                &SynthVoiceArray::generateGroupAudio<false, true, NONE, true> },
+            { &SynthVoiceArray::generateGroupAudio<true, false, NONE, true>,
+                &SynthVoiceArray::generateGroupAudio<true, true, NONE, true> } }
+    };
+
+    //[mono][crossModulation]
+    static constexpr GroupKernel crossModulationKernels[2][4] = {
+        { &SynthVoiceArray::generateGroupAudio<true, true, NONE, false>,
+            &SynthVoiceArray::generateGroupAudio<true, true, FM, false>,
+            &SynthVoiceArray::generateGroupAudio<true, true, RING, false>,
+            &SynthVoiceArray::generateGroupAudio<true, true, HARD_SYNC, false> },
+        { &SynthVoiceArray::generateGroupAudio<true, true, NONE, true>,
+            &SynthVoiceArray::generateGroupAudio<true, true, FM, true>,
+            &SynthVoiceArray::generateGroupAudio<true, true, RING, true>,
+            &SynthVoiceArray::generateGroupAudio<true, true, HARD_SYNC, true> }
+    };
+
+    //modulating osc1 makes no difference when it can't be heard
+    bool wasCrossModulated = isCrossModulated;
+    isCrossModulated = crossModulation != NONE && parentProcessor.osc1.volume > 0.0;
+
+    bool isMono = setUpMix();
+
+    if (isCrossModulated) {
+        groupKernel = crossModulationKernels[isMono][crossModulation];
+    }
+    else {
+        groupKernel = groupKernels[isMono][parentProcessor.osc1.volume > 0.0][parentProcessor.osc2.volume > 0.0];
+    }
+
+    //the pitches of the copies are only worked out at the control points, and they are left where they are while
+    //the oscillators are cross modulated. Copies that have just been added or have just come back need the voices
+    //to set up their ramps again before they can play
+    if (osc1Stack.numCopies > previousOsc1Copies || osc2Stack.numCopies > previousOsc2Copies ||
+        wasCrossModulated != isCrossModulated) {
+        for (int slot = 0; slot < numActiveVoices; ++slot) {
+            needsNewRamp[activeVoices[slot]] = true;
+        }
+    }
+
+    checkFilterSettings();
+    volumeEnvelope.steps.prepare(parentProcessor.volumeEnv);
+    filterEnvelope.steps.prepare(parentProcessor.filter.env);
+
+    //groups where every voice is free aren't in playingGroups, so they cost nothing
+    bool useThreads = isMultithreaded && threadPool.getNumThreads() > 1 && numPlayingGroups > 1 &&
+        blockSize * numActiveVoices >= minSamplesForThreads;
+
+    if (useThreads) {
+        currentBlockSize = blockSize;
+        threadPool.run(*this, numPlayingGroups);
+    }
+
+    for (int slot = 0; slot < numPlayingGroups; ++slot) {
+        if (!useThreads) {
+            renderGroup(playingGroups[slot], blockSize, scratch[0], getGroupOutput(0, 0), getGroupOutput(0, 1));
+        }
+
+        int outputSlot = useThreads ? slot : 0;
+
+        juce::FloatVectorOperations::add(leftOutput, getGroupOutput(outputSlot, 0), blockSize);
+
+        if (rightOutput != nullptr) {
+            juce::FloatVectorOperations::add(rightOutput, getGroupOutput(outputSlot, 1), blockSize);
+        }
+    }
+
+    //every group went through the same control points, so the count is moved on past them in the same way
+    for (int samplesLeft = blockSize; samplesLeft > 0;) {
+        if (samplesUntilControlPoint == 0) {
+            samplesUntilControlPoint = controlInterval;
+        }
+
+        int numSamplesDone = juce::jmin(samplesLeft, samplesUntilControlPoint);
+        samplesUntilControlPoint -= numSamplesDone;
+        samplesLeft -= numSamplesDone;
+    }
+
+    //voices are only freed once every group has been rendered, since freeing changes the lists that all the voices
+    //share. Freeing the last voice of a group takes the group out of playingGroups, so a copy is gone through here
+    int groupsToFinish[numGroups];
+    int numGroupsToFinish = numPlayingGroups;
+
+    for (int slot = 0; slot < numGroupsToFinish; ++slot) {
+        groupsToFinish[slot] = playingGroups[slot];
+    }
+
+    for (int slot = 0; slot < numGroupsToFinish; ++slot) {
+        int firstVoice = groupsToFinish[slot] * simdWidth;
+
+        for (int i = firstVoice; i < firstVoice + simdWidth; ++i) {
+            if (isFinished[i]) {
+                freeVoice(i);
             }
         }
+    }
+}
 
-        if (zeroEncounteredFlag) {
-            zeroEncounteredFlag = false;
-            for (int i = 0; i < firstZeroIndex; ++i) {
-                osc2Audio[0][i] = 0.0f;
-                osc2Audio[1][i] = 0.0f;
+void SynthVoiceArray::runJob(int jobIndex, int threadIndex) {
+    renderGroup(playingGroups[jobIndex], currentBlockSize, scratch[static_cast<size_t>(threadIndex)],
+        getGroupOutput(jobIndex, 0), getGroupOutput(jobIndex, 1));
+}
+
+void SynthVoiceArray::renderGroup(int group, int blockSize, RenderScratch& threadScratch, float* leftOutput,
+    float* rightOutput) {
+    auto& lfo = parentProcessor.lfo;
+    int firstVoice = group * simdWidth;
+
+    for (int i = firstVoice; i < firstVoice + simdWidth; ++i) {
+        if (isFree[i]) {
+            silenceVoice(i);
+        }
+    }
+
+    int samplesUntilPoint = samplesUntilControlPoint;
+
+    for (int startSample = 0; startSample < blockSize;) {
+        bool isControlPoint = samplesUntilPoint == 0;
+
+        if (isControlPoint) {
+            samplesUntilPoint = controlInterval;
+        }
+
+        //the filter LFO phase at the next control point, which is where the ramps are heading
+        Phase filterLFOPhase = parentProcessor.filter.currentLFOPhase +
+            lfo.phaseDelta * static_cast<Phase>(startSample + samplesUntilPoint);
+
+        //the envelopes of the whole group are moved on together first, and then each voice's ramps are pointed at them
+        setUpEnvelopeRamps(volumeEnvelope, parentProcessor.volumeEnv, group, samplesUntilPoint, isControlPoint);
+        setUpEnvelopeRamps(filterEnvelope, parentProcessor.filter.env, group, samplesUntilPoint, isControlPoint);
+
+        for (int i = firstVoice; i < firstVoice + simdWidth; ++i) {
+            if (!isFree[i] && !isFinished[i] && (isControlPoint || needsNewRamp[i])) {
+                setUpVoiceRamp(i, samplesUntilPoint, filterLFOPhase);
+            }
+        }
+
+        //the group goes as far as the next control point, or the first place before it that a voice's ramp stops
+        int numSamples = juce::jmin(blockSize - startSample, samplesUntilPoint);
+
+        for (int i = firstVoice; i < firstVoice + simdWidth; ++i) {
+            if (!isFree[i] && !isFinished[i]) {
+                numSamples = juce::jmin(numSamples, samplesUntilNewRamp[i]);
+            }
+        }
+
+        (this->*groupKernel)(group, numSamples, threadScratch, leftOutput + startSample, rightOutput + startSample);
+
+        samplesUntilPoint -= numSamples;
+
+        for (int i = firstVoice; i < firstVoice + simdWidth; ++i) {
+            if (!isFree[i] && !isFinished[i]) {
+                advanceVoice(i, numSamples, samplesUntilPoint == 0);
             }
         }
+
+        startSample += numSamples;
+    }
+}
+
+template <bool isOsc1Audible, bool isOsc2Audible, SynthVoiceArray::CrossModulation modulation, bool isMono>
+void SynthVoiceArray::generateGroupAudio(int group, int blockSize, RenderScratch& threadScratch, float* leftOutput,
+    float* rightOutput) {
+    int firstVoice = group * simdWidth;
+
+    if constexpr (modulation != NONE) {
+        renderCrossModulation<modulation>(group, blockSize, threadScratch);
+    }
+    else {
+        if constexpr (isOsc1Audible) {
+            renderOscillator(parentProcessor.osc1, osc1Stack, osc1Voices, group, blockSize, threadScratch,
+                threadScratch.osc1Left, threadScratch.osc1Right);
+        }
+        else {
+            skipOscillator(osc1Stack, osc1Voices, group, blockSize);
+        }
+
+        if constexpr (isOsc2Audible) {
+            renderOscillator(parentProcessor.osc2, osc2Stack, osc2Voices, group, blockSize, threadScratch,
+                threadScratch.osc2Left, threadScratch.osc2Right);
+        }
+        else {
+            skipOscillator(osc2Stack, osc2Voices, group, blockSize);
+        }
     }
 
-    if (adsrVol == 0.0 && !isNoteOn) {
-        //generate the audio for this last block. each sample will be given its own volume, so that it converges smoothly
-        //to zero
-        volume = tailVolume * midiVelocity;
+    for (int i = firstVoice; i < firstVoice + simdWidth; ++i) {
+        if (!isFree[i] && currentSampleIndex[i] == 0 && isNoteOn[i] && blockSize > 1) {
+            removeClicksAtNoteStart(i, blockSize, threadScratch, isOsc1Audible, isOsc2Audible);
+        }
+    }
+
+    //the volume only needs multiplying every sample when one of the voices is in a curved stage of its envelope
+    bool isCurved = false;
 
-        for (int i = 0; i < blockSize; ++i) {
-            //this uses a similar computation as when calculating the volume in the release stage
-            auto sampleVolume = (volume) - (volume * i / blockSize);
+    for (int i = firstVoice; i < firstVoice + simdWidth; ++i) {
+        isCurved = isCurved || volumeMultiplier[i] != 1.0f || volumeBreakMultiplier[i] != 1.0f;
+    }
 
-            leftChannelOutput[i] = (osc1Audio[0][i] + osc2Audio[0][i]) * sampleVolume;
-            rightChannelOutput[i] = (osc1Audio[1][i] + osc2Audio[1][i]) * sampleVolume;
+    if (isStateVariable) {
+        if (isCurved) {
+            mixAndFilterGroup<isOsc1Audible, isOsc2Audible, isMono, true, true>(group, blockSize, threadScratch,
+                leftOutput, rightOutput);
+        }
+        else {
+            mixAndFilterGroup<isOsc1Audible, isOsc2Audible, isMono, true, false>(group, blockSize, threadScratch,
+                leftOutput, rightOutput);
         }
     }
-    else
-    {
-        //generate audio as normal
-        for (int i = 0; i < blockSize; ++i) {
-            leftChannelOutput[i] = (osc1Audio[0][i] + osc2Audio[0][i]) * volume;
-            rightChannelOutput[i] = (osc1Audio[1][i] + osc2Audio[1][i]) * volume;
+    else {
+        if (isCurved) {
+            mixAndFilterGroup<isOsc1Audible, isOsc2Audible, isMono, false, true>(group, blockSize, threadScratch,
+                leftOutput, rightOutput);
+        }
+        else {
+            mixAndFilterGroup<isOsc1Audible, isOsc2Audible, isMono, false, false>(group, blockSize, threadScratch,
+                leftOutput, rightOutput);
         }
     }
+}
+
+template <bool isOsc1Audible, bool isOsc2Audible, bool isMono, bool isStateVariableFilter, bool isCurvedVolume>
+void SynthVoiceArray::mixAndFilterGroup(int group, int blockSize, RenderScratch& threadScratch, float* leftOutput,
+    float* rightOutput) {
+    int firstVoice = group * simdWidth;
+    const auto zero = SIMDFloat::expand(0.0f);
+
+    //then the oscillators are panned, mixed, put through the volume envelope and filtered, and the lanes are added
+    //together into the group's output. In mono only monoChannel is worked out, and the other channel is a copy of
+    //it turned down by monoOtherGain
+    constexpr int numChannels = isMono ? 1 : 2;
+    int firstChannel = isMono ? monoChannel : 0;
+    float* outputs[] = { leftOutput, rightOutput };
+
+    //an oscillator without unison is only in its left scratch
+    const float* osc1Channels[] = { threadScratch.osc1Left,
+        osc1Mix.isStereo ? threadScratch.osc1Right : threadScratch.osc1Left };
+    const float* osc2Channels[] = { threadScratch.osc2Left,
+        osc2Mix.isStereo ? threadScratch.osc2Right : threadScratch.osc2Left };
+    const SIMDFloat osc1Gains[] = { SIMDFloat::expand(osc1Mix.leftGain), SIMDFloat::expand(osc1Mix.rightGain) };
+    const SIMDFloat osc2Gains[] = { SIMDFloat::expand(osc2Mix.leftGain), SIMDFloat::expand(osc2Mix.rightGain) };
+
+    auto groupVolume = SIMDFloat::fromRawArray(volume + firstVoice);
+    auto groupVolumeBreakMultiplier = SIMDFloat::fromRawArray(volumeBreakMultiplier + firstVoice);
+    auto groupVolumeBreakDelta = SIMDFloat::fromRawArray(volumeBreakDelta + firstVoice);
+    auto multiplierChange = SIMDFloat::fromRawArray(volumeMultiplier + firstVoice) - groupVolumeBreakMultiplier;
+    auto deltaChange = SIMDFloat::fromRawArray(volumeDelta + firstVoice) - groupVolumeBreakDelta;
+    auto samplesUntilBreak = SIMDFloat::fromRawArray(samplesUntilVolumeBreak + firstVoice);
+    const auto one = SIMDFloat::expand(1.0f);
+    auto peak = SIMDFloat::fromRawArray(outputPeak + firstVoice);
+
+    //the filter state is copied into locals so that it can stay in registers for the whole loop
+    auto& lanes = filterLanes[group];
+    auto c1 = lanes.c1, c2 = lanes.c2, c3 = lanes.c3, c4 = lanes.c4;
+    auto c1Step = lanes.c1Step, c2Step = lanes.c2Step, c3Step = lanes.c3Step, c4Step = lanes.c4Step;
+    SIMDFloat x1[numChannels], x2[numChannels], y1[numChannels], y2[numChannels];
+    SIMDFloat ic1[numChannels], ic2[numChannels];
+
+    for (int ch = 0; ch < numChannels; ++ch) {
+        if constexpr (isStateVariableFilter) {
+            ic1[ch] = lanes.ic1[firstChannel + ch];
+            ic2[ch] = lanes.ic2[firstChannel + ch];
+        }
+        else {
+            x1[ch] = lanes.x1[firstChannel + ch];
+            x2[ch] = lanes.x2[firstChannel + ch];
+            y1[ch] = lanes.y1[firstChannel + ch];
+            y2[ch] = lanes.y2[firstChannel + ch];
+        }
+    }
+
+    //the same for every voice, so they are only worked out once for the block
+    float inputGain = 0.0f, bandGain = 0.0f, lowGain = 0.0f;
+
+    if constexpr (isStateVariableFilter) {
+        parentProcessor.filter.getStateVariableMix(inputGain, bandGain, lowGain);
+    }
+
+    auto m0 = SIMDFloat::expand(inputGain), m1 = SIMDFloat::expand(bandGain), m2 = SIMDFloat::expand(lowGain);
+
+    for (int i = 0; i < blockSize; ++i) {
+        //the volume can only reach zero part of the way through the block when a stolen voice is fading out, and
+        //it mustn't go past zero from there
+        auto sampleVolume = SIMDFloat::max(groupVolume, zero);
+
+        for (int ch = 0; ch < numChannels; ++ch) {
+            int channel = firstChannel + ch;
 
-    std::vector<std::vector<float>> output = { leftChannelOutput, rightChannelOutput };
+            //with neither oscillator audible the filters still get silence, so that they ring out the same as before
+            auto input = zero;
 
-    output = parentProcessor.filter.filterAudio(output, currentSampleIndex, isNoteOn, lastTwoInputSamples,
-        lastTwoOutputSamples, releaseFrequency);
+            if constexpr (isOsc1Audible) {
+                input = SIMDFloat::fromRawArray(osc1Channels[channel] + i * simdWidth) * osc1Gains[channel];
+            }
+
+            if constexpr (isOsc2Audible) {
+                input += SIMDFloat::fromRawArray(osc2Channels[channel] + i * simdWidth) * osc2Gains[channel];
+            }
 
-    currentSampleIndex += blockSize;
+            auto x0 = input * sampleVolume;
+            SIMDFloat y0;
+
+            if constexpr (isStateVariableFilter) {
+                // This is the state variable filter from Andrew Simper's paper:
+                // https://cytomic.com/files/dsp/SvfLinearTrapOptimised2.pdf
+                // with c1, c2 and c3 as a1, a2 and a3. v1 is the band-pass output and v2 the low-pass output
+                auto v3 = x0 - ic2[ch];
+                auto v1 = c1 * ic1[ch] + c2 * v3;
+                auto v2 = ic2[ch] + c2 * ic1[ch] + c3 * v3;
+
+                ic1[ch] = v1 + v1 - ic1[ch];
+                ic2[ch] = v2 + v2 - ic2[ch];
+                y0 = m0 * x0 + m1 * v1 + m2 * v2;
+            }
+            else {
+                // This is simply a code implementation of the biquad found here:
+                // https://webaudio.github.io/Audio-EQ-Cookbook/audio-eq-cookbook.html
+                // b0 and b2 are the same for both the low-pass and the high-pass, so they share c1
+                y0 = c1 * (x0 + x2[ch]) + c2 * x1[ch] - c3 * y1[ch] - c4 * y2[ch];
+
+                x2[ch] = x1[ch];
+                x1[ch] = x0;
+                y2[ch] = y1[ch];
+                y1[ch] = y0;
+            }
 
-    //if blocksize < 2, then there would be another index out of range error
-    //so you have to take care of this case again
-    if (blockSize < 2) 
-    {
+            peak = SIMDFloat::max(peak, SIMDFloat::abs(y0));
+            outputs[channel][i] = y0.sum();
+        }
 
-        //lastTwoInputSamples[0] represents the left channel, and [1] represents the right channel
-        //same with lastTwoOutputSamples
+        if constexpr (isMono) {
+            outputs[1 - firstChannel][i] = outputs[firstChannel][i] * monoOtherGain;
+        }
 
-        lastTwoInputSamples = { { lastTwoInputSamples[0][1], leftChannelOutput[blockSize - 1]},
-        { lastTwoInputSamples[1][1], rightChannelOutput[blockSize - 1]} };
+        //1 before the break and 0 from it on, so each lane switches over to its break multiplier and delta on its
+        //own sample without a branch. Without a break they are the same either side of it
+        auto beforeBreak = SIMDFloat::min(SIMDFloat::max(samplesUntilBreak, zero), one);
 
-        lastTwoOutputSamples = { { lastTwoOutputSamples[0][1], output[0][blockSize - 1] },
-            { lastTwoOutputSamples[1][1], output[1][blockSize - 1]} };
+        //the modulation moves on by the same multiply and add every sample, so it ends up in the same place however
+        //the ramp is split up between blocks
+        if constexpr (isCurvedVolume) {
+            groupVolume = groupVolume * (groupVolumeBreakMultiplier + multiplierChange * beforeBreak) +
+                groupVolumeBreakDelta + deltaChange * beforeBreak;
+        }
+        else {
+            groupVolume += groupVolumeBreakDelta + deltaChange * beforeBreak;
+        }
+        samplesUntilBreak -= one;
+        c1 += c1Step;
+        c2 += c2Step;
+        c3 += c3Step;
+        c4 += c4Step;
     }
-    else if (adsrVol == 0.0 && !isNoteOn)
-    {
-        //reset attributes
-        resetVoice(0.0f, 0);
-        isNoteOn = false;
-        _isFree = true;
-        _midiNote = 0;
-        lastTwoInputSamples = { {0.0f, 0.0f}, {0.0f, 0.0f} };
-        lastTwoOutputSamples = { {0.0f, 0.0f}, {0.0f, 0.0f} };
+
+    SIMDFloat::max(groupVolume, zero).copyToRawArray(volume + firstVoice);
+    samplesUntilBreak.copyToRawArray(samplesUntilVolumeBreak + firstVoice);
+    peak.copyToRawArray(outputPeak + firstVoice);
+    lanes.c1 = c1;
+    lanes.c2 = c2;
+    lanes.c3 = c3;
+    lanes.c4 = c4;
+
+    for (int ch = 0; ch < numChannels; ++ch) {
+        if constexpr (isStateVariableFilter) {
+            lanes.ic1[firstChannel + ch] = ic1[ch];
+            lanes.ic2[firstChannel + ch] = ic2[ch];
+        }
+        else {
+            lanes.x1[firstChannel + ch] = x1[ch];
+            lanes.x2[firstChannel + ch] = x2[ch];
+            lanes.y1[firstChannel + ch] = y1[ch];
+            lanes.y2[firstChannel + ch] = y2[ch];
+        }
     }
-    else 
-    {
-        lastTwoInputSamples = { {leftChannelOutput[blockSize - 2], leftChannelOutput[blockSize - 1]},
-            { rightChannelOutput[blockSize - 2], rightChannelOutput[blockSize - 1]} };
 
-        lastTwoOutputSamples = { { output[0][blockSize - 2], output[0][blockSize - 1] },
-            { output[1][blockSize - 2], output[1][blockSize - 1]} };
+    //the filter is linear, so the other channel's state is the same turned down. Keeping it up to date means
+    //nothing jumps when the pans change and the filter goes back to stereo
+    if constexpr (isMono) {
+        auto otherGain = SIMDFloat::expand(monoOtherGain);
+        int otherChannel = 1 - firstChannel;
+
+        if constexpr (isStateVariableFilter) {
+            lanes.ic1[otherChannel] = ic1[0] * otherGain;
+            lanes.ic2[otherChannel] = ic2[0] * otherGain;
+        }
+        else {
+            lanes.x1[otherChannel] = x1[0] * otherGain;
+            lanes.x2[otherChannel] = x2[0] * otherGain;
+            lanes.y1[otherChannel] = y1[0] * otherGain;
+            lanes.y2[otherChannel] = y2[0] * otherGain;
+        }
     }
+}
 
+void SynthVoiceArray::renderOscillator(const Oscillator& osc, const Oscillator::UnisonStack& stack,
+    OscillatorVoices& voices, int group, int blockSize, RenderScratch& threadScratch, float* leftScratch,
+    float* rightScratch) {
+    int firstVoice = group * simdWidth;
+
+    if (stack.numCopies > 1) {
+        for (int i = firstVoice; i < firstVoice + simdWidth; ++i) {
+            if (isFree[i] || isFinished[i]) {
+                //a silent lane gets zeros, so that nothing left over in the scratch space reaches the filter
+                for (int sample = 0; sample < blockSize; ++sample) {
+                    leftScratch[sample * simdWidth + i - firstVoice] = 0.0f;
+                    rightScratch[sample * simdWidth + i - firstVoice] = 0.0f;
+                }
+            }
+            else {
+                renderUnisonStack(osc, stack, voices, i, blockSize, threadScratch, leftScratch, rightScratch);
+            }
+        }
+
+        return;
+    }
 
-    return output;
+    //first the phases of every lane are advanced together. The phase at each sample (with the phase offset) is
+    //written into the scratch space, where it gets turned into the waveform afterwards
+    auto phase = SIMDPhase::fromRawArray(voices.phase[0] + firstVoice);
+    auto delta = SIMDPhase::fromRawArray(voices.phaseDelta + firstVoice);
+    auto deltaStep = SIMDPhase::fromRawArray(voices.phaseDeltaStep + firstVoice);
+    auto offset = SIMDPhase::expand(osc.getPhaseOffset());
+
+    for (int i = 0; i < blockSize; ++i) {
+        (phase + offset).copyToRawArray(threadScratch.phases + i * simdWidth);
+
+        phase += delta;
+        delta += deltaStep;
+    }
+
+    phase.copyToRawArray(voices.phase[0] + firstVoice);
+    delta.copyToRawArray(voices.phaseDelta + firstVoice);
+
+    //the waveform is left in mono, and gets panned as it is mixed
+    osc.generateWaveform(threadScratch.phases, leftScratch, blockSize * simdWidth,
+        voices.tablePhaseDelta + firstVoice, simdWidth);
 }
 
+void SynthVoiceArray::renderUnisonStack(const Oscillator& osc, const Oscillator::UnisonStack& stack,
+    OscillatorVoices& voices, int index, int blockSize, RenderScratch& threadScratch, float* leftScratch,
+    float* rightScratch) {
+    constexpr int maxRegisters = Oscillator::maxUnison / simdWidth;
+    int numRegisters = (stack.numCopies + simdWidth - 1) / simdWidth;
+    int numCopySlots = numRegisters * simdWidth;
+    int lane = index % simdWidth;
 
-// SynthVoiceArray===========================================================================================================
+    auto offset = SIMDPhase::expand(osc.getPhaseOffset());
 
+    //the copies of this voice are gathered out of the rows so that they sit next to each other. The copies past
+    //the end of the stack have no pitch and no volume, so they stay put and add nothing
+    alignas(SIMDPhase) Phase copyPhases[Oscillator::maxUnison];
+    alignas(SIMDPhase) Phase copyDeltas[Oscillator::maxUnison];
+    alignas(SIMDPhase) Phase copyDeltaSteps[Oscillator::maxUnison];
+
+    for (int copy = 0; copy < numCopySlots; ++copy) {
+        bool isCopy = copy < stack.numCopies;
+
+        copyPhases[copy] = isCopy ? voices.phase[copy][index] : 0;
+        copyDeltas[copy] = isCopy ? voices.copyPhaseDelta[copy][index] : 0;
+        copyDeltaSteps[copy] = isCopy ? voices.copyPhaseDeltaStep[copy][index] : 0;
+    }
+
+    SIMDPhase phase[maxRegisters], delta[maxRegisters], deltaStep[maxRegisters];
+    SIMDFloat leftVolume[maxRegisters], rightVolume[maxRegisters];
+
+    for (int r = 0; r < numRegisters; ++r) {
+        phase[r] = SIMDPhase::fromRawArray(copyPhases + r * simdWidth);
+        delta[r] = SIMDPhase::fromRawArray(copyDeltas + r * simdWidth);
+        deltaStep[r] = SIMDPhase::fromRawArray(copyDeltaSteps + r * simdWidth);
+        leftVolume[r] = SIMDFloat::fromRawArray(stack.leftVolume + r * simdWidth);
+        rightVolume[r] = SIMDFloat::fromRawArray(stack.rightVolume + r * simdWidth);
+    }
 
-SynthVoiceArray::SynthVoiceArray(NEASynthesiserAudioProcessor& p) : parentProcessor(p),
-    arr(32, SynthVoice(p)) {}
+    for (int i = 0; i < blockSize; ++i) {
+        for (int r = 0; r < numRegisters; ++r) {
+            (phase[r] + offset).copyToRawArray(threadScratch.phases + (i * numRegisters + r) * simdWidth);
 
-int SynthVoiceArray::find(int midiNote) const {
-    
-    for (int i = 0; i < maxNumVoices; ++i) {
-        if (arr[i].midiNote() == midiNote) {
-            return i;
+            phase[r] += delta[r];
+            delta[r] += deltaStep[r];
         }
     }
 
-    return -1;
-}
+    for (int r = 0; r < numRegisters; ++r) {
+        phase[r].copyToRawArray(copyPhases + r * simdWidth);
+        delta[r].copyToRawArray(copyDeltas + r * simdWidth);
+    }
+
+    for (int copy = 0; copy < stack.numCopies; ++copy) {
+        voices.phase[copy][index] = copyPhases[copy];
+        voices.copyPhaseDelta[copy][index] = copyDeltas[copy];
+    }
+
+    //the note's own delta moves on by the whole block at once, which is exactly where adding the step every
+    //sample would have left it. The next control point starts the copies from there
+    voices.phaseDelta[index] += voices.phaseDeltaStep[index] * static_cast<Phase>(blockSize);
+
+    //all the copies are read from the table that suits the highest one, which is the last. It is only used to
+    //pick the table, so anything past the sample rate just counts as the highest
+    double highestDelta = voices.tablePhaseDelta[index] * static_cast<double>(stack.pitchRatio[stack.numCopies - 1]);
+    auto highestPhaseDelta = static_cast<Phase>(juce::jmin(highestDelta, Oscillator::phasesPerCycle - 1.0));
 
-void SynthVoiceArray::addVoice(int midiNote, double midiVelocity, int startSampleIndex) {
+    osc.generateWaveform(threadScratch.phases, threadScratch.unison, blockSize * numCopySlots, &highestPhaseDelta,
+        1);
 
-    for (int i = 0; i < maxNumVoices; ++i) {
-        if (arr[i].isFree()) {
-            arr[i].addVoice(midiNote, midiVelocity, startSampleIndex);
-            break;
+    //every copy is panned and the whole stack is added up into this voice's lane
+    for (int i = 0; i < blockSize; ++i) {
+        auto left = SIMDFloat::expand(0.0f);
+        auto right = SIMDFloat::expand(0.0f);
+
+        for (int r = 0; r < numRegisters; ++r) {
+            auto sample = SIMDFloat::fromRawArray(threadScratch.unison + (i * numRegisters + r) * simdWidth);
+
+            left += sample * leftVolume[r];
+            right += sample * rightVolume[r];
         }
+
+        leftScratch[i * simdWidth + lane] = left.sum();
+        rightScratch[i * simdWidth + lane] = right.sum();
     }
 }
 
-std::vector<std::vector<float>> SynthVoiceArray::generateAudio(int blockSize) {
-    
-    std::vector<float> left(blockSize, 0.0f);
-    std::vector<float> right(blockSize, 0.0f);
+template <SynthVoiceArray::CrossModulation modulation>
+void SynthVoiceArray::renderCrossModulation(int group, int blockSize, RenderScratch& threadScratch) {
+    auto& osc1 = parentProcessor.osc1;
+    auto& osc2 = parentProcessor.osc2;
+    int firstVoice = group * simdWidth;
 
-    for (auto& voice : arr) {       //for each element in the arr
-        if (voice.isFree()) {       //if the voice is free, then it is not generating audio so skip this
-            continue;
-        }
+    jassert(parentProcessor.wavetables.isBuilt());
 
-        auto ret = voice.generateAudio(blockSize);
+    //how far osc2 at full swing moves the phase of osc1
+    auto fmScale = static_cast<float>(fmAmount / juce::MathConstants<double>::twoPi * Oscillator::phasesPerCycle);
 
-        for (int i = 0; i < blockSize; ++i) {
-            left[i] += ret[0][i];      //deals with left channel
-            right[i] += ret[1][i];      //deals with right channel
+    const float* osc1Tables[simdWidth];
+    const float* osc2Tables[simdWidth];
+
+    for (int lane = 0; lane < simdWidth; ++lane) {
+        double osc1TableDelta = osc1Voices.tablePhaseDelta[firstVoice + lane];
+        Phase osc2TableDelta = osc2Voices.tablePhaseDelta[firstVoice + lane];
+
+        //FM spreads osc1 out to about fmAmount times the pitch of osc2 either side of its own, so it needs a table
+        //that is band-limited enough for the top of that
+        if constexpr (modulation == FM) {
+            osc1TableDelta = juce::jmin(osc1TableDelta + fmAmount * osc2TableDelta, Oscillator::phasesPerCycle - 1.0);
         }
+
+        osc1Tables[lane] = osc1.getTable(static_cast<Phase>(osc1TableDelta));
+        osc2Tables[lane] = osc2.getTable(osc2TableDelta);
     }
 
-    std::vector<std::vector<float>> output(2, {0.0f});
-    output[0] = left;
-    output[1] = right;
+    Phase osc1Offset = osc1.getPhaseOffset();
+    Phase osc2Offset = osc2.getPhaseOffset();
+
+    //only the first row of phases is used, the same as without unison
+    Phase* osc1Phase = osc1Voices.phase[0] + firstVoice;
+    Phase* osc2Phase = osc2Voices.phase[0] + firstVoice;
+    Phase* osc1Delta = osc1Voices.phaseDelta + firstVoice;
+    Phase* osc2Delta = osc2Voices.phaseDelta + firstVoice;
+    const Phase* osc1DeltaStep = osc1Voices.phaseDeltaStep + firstVoice;
+    const Phase* osc2DeltaStep = osc2Voices.phaseDeltaStep + firstVoice;
+
+    for (int i = 0; i < blockSize; ++i) {
+        for (int lane = 0; lane < simdWidth; ++lane) {
+            int index = i * simdWidth + lane;
+            float modulator = Wavetables::lookUp(osc2Tables[lane], osc2Phase[lane] + osc2Offset);
+            Phase carrierPhase = osc1Phase[lane] + osc1Offset;
+
+            //a negative amount wraps round to the same place as going backwards
+            if constexpr (modulation == FM) {
+                carrierPhase += static_cast<Phase>(static_cast<juce::int64>(modulator * fmScale));
+            }
 
-    return output;
-}
+            float carrier = Wavetables::lookUp(osc1Tables[lane], carrierPhase);
 
-void SynthVoiceArray::resetVoice(int index, double midiVelocity, int startSampleIndex) {
-    arr[index].resetVoice(midiVelocity, startSampleIndex);
+            if constexpr (modulation == RING) {
+                carrier *= modulator;
+            }
+
+            threadScratch.osc1Left[index] = carrier;
+            threadScratch.osc2Left[index] = modulator;
+
+            Phase nextOsc2Phase = osc2Phase[lane] + osc2Delta[lane];
+
+            if constexpr (modulation == HARD_SYNC) {
+                if (nextOsc2Phase < osc2Phase[lane]) {
+                    //osc2 came round to the start of its cycle part of the way through the sample, so osc1 starts
+                    //again from the same point in the sample
+                    double samplesSinceStart = nextOsc2Phase / static_cast<double>(osc2Delta[lane]);
+                    osc1Phase[lane] = static_cast<Phase>(samplesSinceStart * osc1Delta[lane]);
+                }
+                else {
+                    osc1Phase[lane] += osc1Delta[lane];
+                }
+            }
+            else {
+                osc1Phase[lane] += osc1Delta[lane];
+            }
+
+            osc2Phase[lane] = nextOsc2Phase;
+            osc1Delta[lane] += osc1DeltaStep[lane];
+            osc2Delta[lane] += osc2DeltaStep[lane];
+        }
+    }
 }
 
-void SynthVoiceArray::turnOffVoice(int index, int startSampleIndex) {
-    arr[index].turnOffVoice(startSampleIndex);
+void SynthVoiceArray::skipOscillator(const Oscillator::UnisonStack& stack, OscillatorVoices& voices, int group,
+    int blockSize) {
+    //adding a delta that goes up by step every sample for n samples adds delta * n + step * n * (n - 1) / 2 in
+    //total. The phases wrap round in the same way either way, so this ends up exactly where rendering would have
+    auto n = static_cast<Phase>(blockSize);
+    auto triangle = static_cast<Phase>(static_cast<juce::uint64>(blockSize) * (blockSize - 1) / 2);
+    int firstVoice = group * simdWidth;
+
+    for (int i = firstVoice; i < firstVoice + simdWidth; ++i) {
+        //renderUnisonStack() leaves these lanes alone as well, and without unison their deltas are 0 anyway
+        if (isFree[i] || isFinished[i]) {
+            continue;
+        }
+
+        Phase delta = voices.phaseDelta[i];
+        Phase deltaStep = voices.phaseDeltaStep[i];
+
+        if (stack.numCopies > 1) {
+            for (int copy = 0; copy < stack.numCopies; ++copy) {
+                Phase copyDelta = voices.copyPhaseDelta[copy][i];
+                Phase copyDeltaStep = voices.copyPhaseDeltaStep[copy][i];
+
+                voices.phase[copy][i] += copyDelta * n + copyDeltaStep * triangle;
+                voices.copyPhaseDelta[copy][i] = copyDelta + copyDeltaStep * n;
+            }
+        }
+        else {
+            voices.phase[0][i] += delta * n + deltaStep * triangle;
+        }
+
+        voices.phaseDelta[i] = delta + deltaStep * n;
+    }
 }
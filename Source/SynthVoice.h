@@ -11,58 +11,356 @@
 #pragma once
 #include "JuceHeader.h"
 #include <vector>
+#include "Envelope.h"
+#include "Filter.h"
+#include "Oscillator.h"
+#include "VoiceThreadPool.h"
 
 class NEASynthesiserAudioProcessor;
 
-class SynthVoice {
-private:
-    int currentSampleIndex;
-    int startSampleIndex;
-    double currentOsc1Angle;
-    double currentOsc2Angle;
-    double currentOsc1LFOAngle;
-    double currentOsc2LFOAngle;
-    int _midiNote;
-    double midiVelocity;
-    bool isNoteOn;
-    bool _isFree;
-    double tailVolume;              //the volume calculated in getCurrentVolume() right before the tail
-    double releaseVolume;           //the last volume of the note before being released
-    double releaseFrequency;        //the last centre frequency of the filter before the note is released
-
-    std::vector<std::vector<float>> lastTwoInputSamples;
-    std::vector<std::vector<float>> lastTwoOutputSamples;
+//The voices are stored as a structure of arrays rather than as an array of voice objects. Every attribute of a voice
+//has its own array, indexed by the number of the voice. Voice i sits in lane (i % simdWidth) of group (i / simdWidth),
+//so the oscillator phases, volumes and filters of a whole group can be worked out at once in a SIMDRegister.
+//The groups don't share any state while they render, so they can also be spread across a VoiceThreadPool
+class SynthVoiceArray : public VoiceThreadPool::Job {
+public:
+    using SIMDFloat = juce::dsp::SIMDRegister<float>;
+    using SIMDPhase = juce::dsp::SIMDRegister<Oscillator::Phase>;
 
-    NEASynthesiserAudioProcessor& parentProcessor;
+    //what happens when a note is played and every voice is already in use. Whichever is chosen, a stolen voice
+    //fades out over a few milliseconds in one of the spare voices instead of stopping dead
+    enum StealingPolicy {
+        RELEASE_FIRST,      //steal the voice that has been released for the longest, otherwise the oldest voice
+        OLDEST,             //steal the voice whose note was played the longest ago
+        QUIETEST,           //steal the voice with the lowest volume
+        SAME_NOTE           //playing a note that is already sounding steals its voice instead of letting it ring
+                            //out alongside the new one. Otherwise the same as RELEASE_FIRST
+    };
 
-    double getCurrentVolume();
+    //how osc2 changes the sound of osc1. Apart from NONE, the two oscillators are worked out together one sample at
+    //a time, so each only plays its first unison copy and is always read from the wavetables
+    enum CrossModulation {
+        NONE,
+        FM,                 //osc2 pushes the phase of osc1 back and forth by up to fmAmount radians, the way the
+                            //classic FM synths do it
+        RING,               //osc1 is multiplied by osc2
+        HARD_SYNC           //osc1 starts its cycle again every time osc2 does
+    };
 
-public:
-    SynthVoice(NEASynthesiserAudioProcessor&);
-    void resetVoice(double midiVelocity, int startSampleIndex);
-    void addVoice(int midiNote, double midiVelocity, int startSampleIndex);
-    void turnOffVoice(int startSampleIndex);
+    static constexpr int simdWidth = static_cast<int>(SIMDFloat::SIMDNumElements);
+    static constexpr int maxPolyphony = 256;
+    static constexpr int numSpareVoices = 16;   //extra voices used only by stolen voices that are fading out
+    static constexpr int maxNumVoices = maxPolyphony + numSpareVoices;
+    static constexpr int numGroups = maxNumVoices / simdWidth;
+    static constexpr int numMidiNotes = 128;
+    static constexpr double stealFadeSeconds = 0.005;
+    static constexpr int maxHelperThreads = 7;
+    static constexpr int maxControlInterval = 256;     //64 samples, made 4 times longer in Eco quality
 
-    const int& midiNote() const;    //getter method
-    const bool& isFree() const;    //getter method
+    //the threads are only used when the number of samples in the block times the number of playing voices is at
+    //least this much. Waking the other threads and adding up their output costs more than it saves below that
+    static constexpr int minSamplesForThreads = 16384;
 
-    std::vector<std::vector<float>> generateAudio(int blockSize);
-};
+    static_assert(SIMDPhase::SIMDNumElements == SIMDFloat::SIMDNumElements,
+        "the phases of a group have to fit in one register");
+    static_assert(maxNumVoices % simdWidth == 0, "the voices have to fill a whole number of SIMD groups");
+    static_assert(Oscillator::maxUnison % simdWidth == 0, "the unison copies have to fill whole SIMDRegisters");
+    static_assert(maxControlInterval <= EnvelopeSteps::maxRampLength,
+        "a ramp can't be longer than the envelope tables go");
+
+    int polyphony;                          //between 1 and maxPolyphony inclusive
+    enum StealingPolicy stealingPolicy;
+    bool isMultithreaded;                   //whether big blocks may be rendered on the thread pool
+    float silenceThreshold;                 //as a gain. A released voice is freed once it is quieter than this
+    enum CrossModulation crossModulation;
+    double fmAmount;                        //between 0 and 10 radians
+
+    //how many samples apart the envelopes and LFOs are worked out. In between, the volume, pitch and filter
+    //coefficients of each voice move in a straight line from one to the next. The points are counted from when the
+    //plugin started rather than from the start of each block, so the sound doesn't depend on the host's block size
+    int controlInterval;
+
+    SynthVoiceArray(NEASynthesiserAudioProcessor&);
+
+    //these find the voice for the note in constant time, and never drop a note
+    void startNote(int midiNote, double midiVelocity);
+    void stopNote(int midiNote);
+
+    //allocates the scratch space, with room for every thread the pool could have. This is called from
+    //prepareToPlay(), and releaseResources() stops the threads
+    void prepare(int samplesPerBlock);
+    void releaseResources();
+
+    //starts the thread pool if shouldRun is true and the voices have been prepared, and stops it otherwise. The
+    //processor calls this on the message thread whenever Multithreaded Rendering is turned on or off
+    void setThreadsRunning(bool shouldRun);
+
+    //moves every playing voice over to a new sample rate, which is rateRatio times the old one. The processor
+    //calls this when the quality turns oversampling on or off, once the settings have been read at the new rate
+    void changeSampleRate(double rateRatio);
+
+    //adds the audio of every active voice onto numSamples samples of outputBuffer, starting at startSample. The
+    //processor calls this for each stretch of the block between two MIDI events, so the voices always start and
+    //stop at the beginning of the audio they are asked for
+    void generateAudio(juce::AudioBuffer<float>& outputBuffer, int startSample, int numSamples);
+
+    //renders one of the playing groups on a thread of the pool
+    void runJob(int jobIndex, int threadIndex) override;
 
-class SynthVoiceArray {
 private:
-    std::vector<SynthVoice> arr;
-    const int maxNumVoices = 32;
+    //the memory that one thread needs to render a group. The left and right channels of each oscillator have the
+    //lanes of each sample next to each other. phases has room for the phase of every unison copy of one voice (or
+    //of every lane without unison) for the whole block, and unison for the waveform of every copy
+    struct RenderScratch {
+        std::vector<float> memory;
+        std::vector<Oscillator::Phase> phaseMemory;
+        float* osc1Left;
+        float* osc1Right;
+        float* osc2Left;
+        float* osc2Right;
+        float* unison;
+        Oscillator::Phase* phases;
+    };
+
+    //the voice that the last note on for each midi note went to, or -1 if that note isn't sounding
+    int voiceForNote[numMidiNotes];
+
+    //a stack of the voices that are free, so that finding one doesn't mean searching through all of them
+    int freeVoices[maxNumVoices];
+    int numFreeVoices;
+
+    //the voices that are in use, in no particular order, and where each one is in the list (-1 for free voices).
+    //Everything that only cares about playing voices goes through this instead of looking at every voice
+    int activeVoices[maxNumVoices];
+    int activeVoiceSlot[maxNumVoices];
+    int numActiveVoices;
+
+    //the groups with at least one voice in use, kept in order, and how many voices are in use in each group.
+    //These are updated as voices start and finish rather than worked out again every block
+    int playingGroups[numGroups];
+    int numPlayingGroups;
+    int numActiveVoicesInGroup[numGroups];
+
+    int numSoundingVoices;          //voices that are in use and haven't been stolen, which is what polyphony limits
+    juce::uint64 noteCounter;       //goes up by one with every note on and note off, to tell which voice is oldest
+
+    //bookkeeping for each voice. These are only looked at once per block
+    int currentSampleIndex[maxNumVoices];
+    Oscillator::Phase currentLFOPhase[maxNumVoices];    //both oscillators of a voice share the pitch LFO
+    int midiNote[maxNumVoices];                 //-1 for free voices, so they can never look like they are playing a note
+    double midiVelocity[maxNumVoices];
+    bool isNoteOn[maxNumVoices];
+    bool isFree[maxNumVoices];
+    bool needsNewRamp[maxNumVoices];            //true when a note on or off means the voice can't wait for the next
+                                                //control point to change course
+    int samplesUntilNewRamp[maxNumVoices];      //how long until the voice's ramp stops, which is at the next control
+                                                //point unless the envelope turns two corners before that
+    bool isFinished[maxNumVoices];              //true once the voice is silent, until it gets freed after the block
+    juce::uint64 noteOnTime[maxNumVoices];      //the value of noteCounter when the note was played
+    juce::uint64 noteOffTime[maxNumVoices];     //the value of noteCounter when the note was released
+    bool isStolen[maxNumVoices];                //true while the voice is fading out after being stolen
+    int fadeSamplesLeft[maxNumVoices];
+    float fadeStartVolume[maxNumVoices];
+
+    //the state of one oscillator for every voice, which is read by the SIMD loops. There is one row of phases for
+    //every unison copy, and without unison only the first row is used. The steps are how much the phase deltas
+    //change by every sample, and are really signed, but adding them as unsigned numbers wraps round to the same answer
+    struct OscillatorVoices {
+        alignas(SIMDPhase) Oscillator::Phase phase[Oscillator::maxUnison][maxNumVoices];
+        alignas(SIMDPhase) Oscillator::Phase phaseDelta[maxNumVoices];        //for the note's own pitch
+        alignas(SIMDPhase) Oscillator::Phase phaseDeltaStep[maxNumVoices];
+
+        //the deltas of the unison copies, with each copy's pitch ratio applied. These are worked out from the note's
+        //own delta at every control point, since a pitch ratio can't be applied to a Phase in a register
+        alignas(SIMDPhase) Oscillator::Phase copyPhaseDelta[Oscillator::maxUnison][maxNumVoices];
+        alignas(SIMDPhase) Oscillator::Phase copyPhaseDeltaStep[Oscillator::maxUnison][maxNumVoices];
+
+        //the highest the note's delta gets before the next control point, which picks the band-limited table. It
+        //is only changed at the control points so that the table doesn't depend on how the block is split up
+        alignas(SIMDPhase) Oscillator::Phase tablePhaseDelta[maxNumVoices];
+    };
+
+    OscillatorVoices osc1Voices;
+    OscillatorVoices osc2Voices;
+
+    //the state of one envelope for every voice. Rather than working out each voice's envelope from scratch at every
+    //control point, which takes an exponential per voice once the stages are curved, each group's levels are moved
+    //on from the last control point together by its EnvelopeLanes, using tables that every voice shares. The volume
+    //and the filter each have one
+    struct EnvelopeVoices {
+        EnvelopeSteps steps;
+        EnvelopeLanes lanes[numGroups];
+    };
+
+    EnvelopeVoices volumeEnvelope;
+    EnvelopeVoices filterEnvelope;
+    alignas(SIMDFloat) float volume[maxNumVoices];          //the current volume, including velocity
+
+    //every sample the volume is multiplied by volumeMultiplier and then volumeDelta is added, which follows a
+    //curved stage of the envelope exactly. For a straight stage the multiplier is just 1
+    alignas(SIMDFloat) float volumeMultiplier[maxNumVoices];
+    alignas(SIMDFloat) float volumeDelta[maxNumVoices];
+
+    //a stage of the envelope can end in between two control points. The volume then moves on with volumeMultiplier
+    //and volumeDelta until samplesUntilVolumeBreak gets to 0, and with the break ones from there on. When no stage
+    //ends they are the same
+    alignas(SIMDFloat) float volumeBreakMultiplier[maxNumVoices];
+    alignas(SIMDFloat) float volumeBreakDelta[maxNumVoices];
+    alignas(SIMDFloat) float samplesUntilVolumeBreak[maxNumVoices];
+
+    //the loudest sample each voice has put out (in either channel, after the filter) since the last control point.
+    //In mono the other channel is quieter, so only the one that is filtered counts
+    alignas(SIMDFloat) float outputPeak[maxNumVoices];
+    FilterLanes filterLanes[numGroups];
+
+    //the coefficients that each voice's filter was last pointed at, and the centre frequency and filter LFO phase
+    //they were worked out for. Working them out takes a sine, a cosine and a power, so they are only worked out
+    //again when one of those changes. In a held note with the LFO elsewhere that is never
+    struct FilterTarget {
+        double frequency;
+        Oscillator::Phase lfoPhase;     //0 when the LFO isn't on the filter
+        float c1, c2, c3, c4;
+        bool isValid;
+    };
+
+    FilterTarget filterTarget[maxNumVoices];
+
+    //the settings that filterTarget was worked out with. When any of them changes, every target is worked out again
+    FrequencyFilter::FilterType filterType;
+    bool isStateVariable;           //whether the filter is the state variable one rather than the biquad
+    double filterResonance;
+    double filterLFOAmount;         //1 when the LFO isn't on the filter
+    double filterSampleRate;
+
+    //scratch space for each thread that can render, with the audio thread's first. This is allocated in prepare()
+    //so that nothing has to be allocated while rendering on the audio thread
+    std::vector<RenderScratch> scratch;
+    int scratchSize;
+
+    //every group renders into its own stereo buffer here, and the buffers are added onto the output one group at a
+    //time in order. The sum is then the same however the groups were split between threads, and the same as when
+    //they are all rendered on the audio thread, which reuses the first buffer for every group
+    std::vector<float> groupOutputMemory;
+
+    int currentBlockSize;           //the size of the block that the thread pool is rendering
+    int samplesUntilControlPoint;   //how far into the block the next control point is. 0 means right at the start
+
+    //the unison copies of each oscillator for the block being rendered
+    Oscillator::UnisonStack osc1Stack;
+    Oscillator::UnisonStack osc2Stack;
+    bool isCrossModulated;          //whether the last block was rendered with one of the cross modulation kernels
+
+    //how the scratch of each oscillator is turned into the two channels as it is mixed. Without unison an
+    //oscillator is rendered in mono into its left scratch, and the gains pan it and set its volume. A unison stack
+    //pans each copy differently, so it is rendered into both and the gains are 1
+    struct OscillatorMix {
+        float leftGain;
+        float rightGain;
+        bool isStereo;
+    };
+
+    OscillatorMix osc1Mix;
+    OscillatorMix osc2Mix;
+
+    //when everything that can be heard is in mono and panned the same way, the two channels only differ by a gain.
+    //Then the filter only runs on monoChannel, which is the louder one, and the other is monoOtherGain times it
+    int monoChannel;
+    float monoOtherGain;
+
+    VoiceThreadPool threadPool;
+    bool isPrepared;                //between prepare() and releaseResources()
 
     NEASynthesiserAudioProcessor& parentProcessor;
 
-public:
-    SynthVoiceArray(NEASynthesiserAudioProcessor&);
-    int find(int midiNote) const;
-    void addVoice(int midiNote, double midiVelocity, int startSampleIndex);
-    void resetVoice(int index, double midiVelocity, int startSampleIndex);
-    void turnOffVoice(int index, int startSampleIndex);
+    //where a voice's envelope is on its current sample, worked out from scratch
+    double getEnvelopeLevel(const EnvelopeVoices& envelope, const Envelope& settings, int index) const;
 
-    std::vector<std::vector<float>> generateAudio(int blockSize);
-};
+    //the release starts from wherever the envelope is on the voice's current sample
+    void releaseEnvelope(EnvelopeVoices& envelope, const Envelope& settings, int index);
+
+    //works out where the envelope of every voice in the group that needs a new ramp will be rampLength samples
+    //from now, and how it gets there
+    void setUpEnvelopeRamps(EnvelopeVoices& envelope, const Envelope& settings, int group, int rampLength,
+        bool isControlPoint);
 
+    //sets the volume to move in a straight line by delta every sample, with no break
+    void setStraightVolumeRamp(int index, float delta);
+
+    int allocateVoice();
+    int chooseVoiceToSteal() const;
+    void stealVoice(int index);
+    void resetVoice(int index, int midiNote, double midiVelocity);
+    void turnOffVoice(int index);
+
+    //startVoiceModulation() works out where a new note's modulation starts from, and setUpVoiceRamp() points the
+    //modulation of a voice at its values rampLength samples from now
+    void startVoiceModulation(int index);
+    void setUpVoiceRamp(int index, int rampLength, Oscillator::Phase filterLFOPhase);
+    void setUpOscillatorRamp(OscillatorVoices& voices, const Oscillator::UnisonStack& stack, int index,
+        Oscillator::Phase targetPhaseDelta, int rampLength);
+    void silenceVoice(int index);
+
+    //the coefficients for a voice's filter at the given centre frequency and filter LFO phase, worked out again
+    //only if they have changed since the last time
+    const FilterTarget& getFilterTarget(int index, double frequency, Oscillator::Phase filterLFOPhase);
+
+    //moves a voice's filter straight to the coefficients for the given centre frequency and filter LFO phase
+    void setFilterCoefficients(int index, double frequency, Oscillator::Phase filterLFOPhase);
+    void checkFilterSettings();
+    void advanceVoice(int index, int numSamples, bool isControlPoint);
+    void activateVoice(int index);
+    void freeVoice(int index);
+    void clearVoice(int index);
+    int getStealFadeLength() const;
+    void removeClicksAtNoteStart(int index, int blockSize, RenderScratch& threadScratch, bool isOsc1Audible,
+        bool isOsc2Audible);
+
+    void allocateScratch(int samplesPerBlock);
+
+    //the audio thread renders as well, so one core is left for it
+    static int getNumHelperThreads();
+
+    //works out osc1Mix and osc2Mix for the block, and whether it can be filtered in mono
+    bool setUpMix();
+    float* getGroupOutput(int slot, int channel);
+
+    //renderGroup() works through the block one control point at a time, and generateGroupAudio() renders the part
+    //between two of them. They write the group's output into leftOutput and rightOutput rather than adding onto them
+    void renderGroup(int group, int blockSize, RenderScratch& threadScratch, float* leftOutput, float* rightOutput);
+
+    //there is a version of generateGroupAudio() for each combination of oscillators that can be heard, so that an
+    //oscillator turned all the way down costs almost nothing and the mixing loop doesn't check for it every sample.
+    //There is also one for each kind of cross modulation, which renders both, and a mono version of each.
+    //generateAudio() picks the one to use for the block
+    template <bool isOsc1Audible, bool isOsc2Audible, CrossModulation modulation, bool isMono>
+    void generateGroupAudio(int group, int blockSize, RenderScratch& threadScratch, float* leftOutput, float* rightOutput);
+
+    //the part of generateGroupAudio() that mixes the oscillators and filters them, with a version for each kind of
+    //filter, and for whether any voice in the group is in a curved stage of its volume envelope. generateGroupAudio()
+    //picks one for the whole block
+    template <bool isOsc1Audible, bool isOsc2Audible, bool isMono, bool isStateVariableFilter, bool isCurvedVolume>
+    void mixAndFilterGroup(int group, int blockSize, RenderScratch& threadScratch, float* leftOutput,
+        float* rightOutput);
+
+    using GroupKernel = void (SynthVoiceArray::*)(int, int, RenderScratch&, float*, float*);
+    GroupKernel groupKernel;
+
+    //these write one oscillator of the group into its scratch. Without unison the voices of the group are worked out
+    //side by side in the lanes, and only the bare waveform goes into the left scratch. With unison each voice is
+    //worked out on its own, with its copies side by side in the lanes instead, and the stack is panned and turned
+    //down into both
+    void renderOscillator(const Oscillator& osc, const Oscillator::UnisonStack& stack, OscillatorVoices& voices,
+        int group, int blockSize, RenderScratch& threadScratch, float* leftScratch, float* rightScratch);
+    void renderUnisonStack(const Oscillator& osc, const Oscillator::UnisonStack& stack, OscillatorVoices& voices,
+        int index, int blockSize, RenderScratch& threadScratch, float* leftScratch, float* rightScratch);
+
+    //writes both oscillators of the group into their left scratch, with osc1 modulated by osc2. The phases of both are
+    //advanced together in the same loop that reads the waveforms, since with FM and hard sync the phase of osc1
+    //depends on the value or phase of osc2 at every sample
+    template <CrossModulation modulation>
+    void renderCrossModulation(int group, int blockSize, RenderScratch& threadScratch);
+
+    //moves an oscillator that can't be heard on by blockSize samples without rendering it, so that it is at the
+    //same phase as if it had been when it is turned back up
+    void skipOscillator(const Oscillator::UnisonStack& stack, OscillatorVoices& voices, int group, int blockSize);
+};
@@ -0,0 +1,125 @@
+/*
+  ==============================================================================
+
+    VoiceThreadPool.cpp
+    Created: 17 Oct 2026 10:12:19am
+    Author:  user
+
+  ==============================================================================
+*/
+
+#include "VoiceThreadPool.h"
+#include <thread>
+
+VoiceThreadPool::VoiceThreadPool() : numThreads(1), currentJob(nullptr), jobsLeft(0), numFinishedJobs(0) {
+}
+
+VoiceThreadPool::~VoiceThreadPool() {
+    stop();
+}
+
+void VoiceThreadPool::start(int numHelperThreads) {
+    const juce::ScopedLock lock(threadsLock);
+
+    if (static_cast<int>(threads.size()) == numHelperThreads) {
+        return;
+    }
+
+    stop();
+
+    for (int i = 0; i < numHelperThreads; ++i) {
+        //the audio thread is thread 0, so the helpers are numbered from 1
+        threads.push_back(std::make_unique<HelperThread>(*this, i + 1));
+        threads.back()->startRealtimeThread(juce::Thread::RealtimeOptions{});
+    }
+
+    numThreads = numHelperThreads + 1;
+}
+
+void VoiceThreadPool::stop() {
+    const juce::ScopedLock lock(threadsLock);
+
+    numThreads = 1;
+
+    for (auto& thread : threads) {
+        thread->signalThreadShouldExit();
+        thread->wakeUp.signal();
+    }
+
+    for (auto& thread : threads) {
+        thread->stopThread(1000);
+    }
+
+    threads.clear();
+}
+
+int VoiceThreadPool::getNumThreads() const {
+    return numThreads.load();
+}
+
+void VoiceThreadPool::run(Job& job, int numJobs) {
+    //if the threads are being started or stopped, waiting for them could take far longer than the block, so the
+    //jobs are all done here instead. They give the same results whichever thread runs them
+    const juce::ScopedTryLock lock(threadsLock);
+
+    if (!lock.isLocked()) {
+        for (int i = 0; i < numJobs; ++i) {
+            job.runJob(i, 0);
+        }
+
+        return;
+    }
+
+    //the job has to be in place before jobsLeft is set, because a helper that is late from the last call can
+    //take a job as soon as it is
+    currentJob = &job;
+    numFinishedJobs = 0;
+    jobsLeft = static_cast<juce::uint64>(numJobs) << 32;
+
+    for (auto& thread : threads) {
+        thread->wakeUp.signal();
+    }
+
+    workOnJobs(0);
+
+    //the jobs that the helpers took might still be running, and the results can't be used until they are done.
+    //They are short, so this just spins rather than going to sleep
+    while (numFinishedJobs.load() < numJobs) {
+        std::this_thread::yield();
+    }
+}
+
+void VoiceThreadPool::workOnJobs(int threadIndex) {
+    auto jobs = jobsLeft.load();
+
+    while (true) {
+        auto numJobs = static_cast<int>(jobs >> 32);
+        auto jobIndex = static_cast<int>(jobs & 0xffffffff);
+
+        if (jobIndex >= numJobs) {
+            return;
+        }
+
+        //if another thread took the job first, jobs is reloaded and this tries again with the next one
+        if (jobsLeft.compare_exchange_weak(jobs, jobs + 1)) {
+            currentJob.load()->runJob(jobIndex, threadIndex);
+            ++numFinishedJobs;
+            jobs = jobsLeft.load();
+        }
+    }
+}
+
+// HelperThread===========================================================================================================
+
+VoiceThreadPool::HelperThread::HelperThread(VoiceThreadPool& p, int index)
+    : juce::Thread("Voice Renderer"), pool(p), threadIndex(index) {
+}
+
+void VoiceThreadPool::HelperThread::run() {
+    while (!threadShouldExit()) {
+        //stop() signals the event after asking the thread to exit, so this can sleep until there is work to do
+        if (wakeUp.wait(-1)) {
+            pool.workOnJobs(threadIndex);
+        }
+    }
+}
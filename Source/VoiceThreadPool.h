@@ -0,0 +1,73 @@
+/*
+  ==============================================================================
+
+    VoiceThreadPool.h
+    Created: 17 Oct 2026 10:12:05am
+    Author:  user
+
+  ==============================================================================
+*/
+
+#pragma once
+#include "JuceHeader.h"
+#include <atomic>
+#include <memory>
+#include <vector>
+
+//a few real-time threads that help the audio thread render the voices. The audio thread hands the pool a number of
+//jobs and then works through them alongside the other threads. Each thread keeps taking whichever job nobody has
+//started yet, so a thread that gets through its jobs quickly takes work off the others instead of sitting idle
+class VoiceThreadPool {
+public:
+    //anything that wants its work split up across the threads
+    class Job {
+    public:
+        virtual ~Job() = default;
+
+        //threadIndex is 0 on the audio thread and 1 to getNumThreads() - 1 on the others, so it can be used to
+        //pick out memory that only that thread touches
+        virtual void runJob(int jobIndex, int threadIndex) = 0;
+    };
+
+    VoiceThreadPool();
+    ~VoiceThreadPool();
+
+    //these start and stop the threads, so they must not be called from the audio thread. They can be called while
+    //the audio thread is rendering though, which then does all of the jobs itself until the threads have changed
+    void start(int numHelperThreads);
+    void stop();
+
+    //the number of threads that can work on jobs at once, including the audio thread
+    int getNumThreads() const;
+
+    //calls job.runJob() once for every job index from 0 to numJobs - 1, and returns when they have all finished
+    void run(Job& job, int numJobs);
+
+private:
+    class HelperThread : public juce::Thread {
+    public:
+        HelperThread(VoiceThreadPool& pool, int threadIndex);
+        void run() override;
+
+        juce::WaitableEvent wakeUp;
+
+    private:
+        VoiceThreadPool& pool;
+        int threadIndex;
+    };
+
+    std::vector<std::unique_ptr<HelperThread>> threads;
+    std::atomic<int> numThreads;
+
+    //held by start() and stop() while they change the threads, and by run() while the threads are working
+    juce::CriticalSection threadsLock;
+
+    std::atomic<Job*> currentJob;
+
+    //the number of jobs in the top half and the next job that no thread has taken yet in the bottom half. They are
+    //kept together so that a thread taking a job can never mix up the count of one run with the jobs of another
+    std::atomic<juce::uint64> jobsLeft;
+    std::atomic<int> numFinishedJobs;
+
+    void workOnJobs(int threadIndex);
+};
@@ -0,0 +1,96 @@
+/*
+  ==============================================================================
+
+    Wavetables.cpp
+    Created: 17 Oct 2026 2:41:52pm
+    Author:  user
+
+  ==============================================================================
+*/
+
+#include "Wavetables.h"
+#include "FastMath.h"
+#include <cmath>
+
+Wavetables::Wavetables() : built(false) {
+}
+
+bool Wavetables::isBuilt() const {
+    return built;
+}
+
+float* Wavetables::getLevel(int waveform, int level) {
+    return tables.data() + (waveform * numLevels + level) * paddedTableSize;
+}
+
+const float* Wavetables::getTable(int waveform, float cyclesPerSample) const {
+    //a level with h harmonics is fine as long as h times the frequency is under half the sample rate. In cycles per
+    //sample that means h * cycles < 0.5, so the level is picked from how many times 1 / (2 * maxHarmonics) the
+    //frequency is
+    double cycles = cyclesPerSample;
+    int level = 0;
+
+    if (cycles > 0.0) {
+        level = static_cast<int>(std::ceil(FastMath::log2(cycles * 2 * maxHarmonics)));
+        level = juce::jlimit(0, numLevels - 1, level);
+    }
+
+    return tables.data() + (waveform * numLevels + level) * paddedTableSize;
+}
+
+void Wavetables::build() {
+    if (built) {
+        return;
+    }
+
+    tables.assign(static_cast<size_t>(numWaveforms * numLevels * paddedTableSize), 0.0f);
+
+    //sin(h * x) at every point of the table is just the sine table read h times as fast, so one sine table is
+    //worked out first and then every harmonic is read from it
+    std::vector<double> sine(tableSize);
+
+    for (int i = 0; i < tableSize; ++i) {
+        sine[i] = std::sin(juce::MathConstants<double>::twoPi * i / tableSize);
+    }
+
+    //the sums are kept in double and built up from the last level, which has the fewest harmonics. Each level
+    //before it is the same sum with the next lot of harmonics added on
+    std::vector<double> square(tableSize, 0.0);
+    std::vector<double> saw(tableSize, 0.0);
+    int harmonicsSoFar = 0;
+
+    for (int level = numLevels - 1; level >= 0; --level) {
+        int levelHarmonics = maxHarmonics >> level;
+
+        for (int h = harmonicsSoFar + 1; h <= levelHarmonics; ++h) {
+            //the square is 1 for the first half of the cycle and -1 for the second, which only has odd harmonics.
+            //The saw goes from 0 up to 1 at pi, jumps to -1 and goes back up to 0
+            double squareAmount = (h % 2 == 1) ? 4.0 / (juce::MathConstants<double>::pi * h) : 0.0;
+            double sawAmount = ((h % 2 == 1) ? 2.0 : -2.0) / (juce::MathConstants<double>::pi * h);
+
+            for (int i = 0; i < tableSize; ++i) {
+                double harmonic = sine[static_cast<size_t>((static_cast<long long>(h) * i) % tableSize)];
+
+                square[i] += squareAmount * harmonic;
+                saw[i] += sawAmount * harmonic;
+            }
+        }
+
+        harmonicsSoFar = levelHarmonics;
+
+        //the sine has no harmonics to leave out, so it is the same at every level
+        const std::vector<double>* sums[numWaveforms] = { &sine, &square, &saw };
+
+        for (int waveform = 0; waveform < numWaveforms; ++waveform) {
+            float* table = getLevel(waveform, level);
+
+            for (int i = 0; i < tableSize; ++i) {
+                table[i] = static_cast<float>((*sums[waveform])[i]);
+            }
+
+            table[tableSize] = table[0];
+        }
+    }
+
+    built = true;
+}
@@ -0,0 +1,56 @@
+/*
+  ==============================================================================
+
+    Wavetables.h
+    Created: 17 Oct 2026 2:41:37pm
+    Author:  user
+
+  ==============================================================================
+*/
+
+#pragma once
+#include <JuceHeader.h>
+#include <vector>
+
+//one cycle of each waveform, stored as a table that the oscillators read from instead of working the waveform out
+//every sample. Each waveform has a table for every octave (a mipmap): the table for higher notes leaves out the
+//harmonics that would go past half the sample rate, which is what makes the square and saw alias at high notes
+class Wavetables {
+public:
+    static constexpr int tableBits = 11;
+    static constexpr int tableSize = 1 << tableBits;
+    static constexpr int numLevels = 10;
+    static constexpr int maxHarmonics = 512;    //in the first level. Each level after that has half as many
+    static constexpr int numWaveforms = 3;      //in the same order as Oscillator::OscillatorType
+
+    Wavetables();
+
+    //fills in every table. This takes a few milliseconds so it is done in prepareToPlay(), never on the audio thread
+    void build();
+    bool isBuilt() const;
+
+    //the table for a waveform that goes through cyclesPerSample cycles every sample
+    const float* getTable(int waveform, float cyclesPerSample) const;
+
+    //reads a table at a 32 bit phase (see Oscillator::Phase), in between the two nearest points. The top bits of
+    //the phase are the point in the table, and the rest are how far along it is towards the next one
+    static inline float lookUp(const float* table, juce::uint32 phase) {
+        auto index = phase >> fractionBits;
+        auto fraction = static_cast<float>(phase & fractionMask) * (1.0f / (1u << fractionBits));
+
+        return table[index] + fraction * (table[index + 1] - table[index]);
+    }
+
+private:
+    static constexpr int fractionBits = 32 - tableBits;
+    static constexpr juce::uint32 fractionMask = (1u << fractionBits) - 1;
+
+    //each table has an extra point at the end which repeats the first, so that reading the last point never has
+    //to wrap around
+    static constexpr int paddedTableSize = tableSize + 1;
+
+    std::vector<float> tables;     //[waveform][level][point]
+    bool built;
+
+    float* getLevel(int waveform, int level);
+};